@@ -4,14 +4,63 @@
 #include <Rcpp.h>
 #include "jsonify/from_json/from_json.hpp"
 #include "jsonify/from_json/parse_json.hpp"
+#include "jsonify/from_json/sax.hpp"
+#include "jsonify/from_json/schema.hpp"
+#include "jsonify/from_json/select.hpp"
+#include "jsonify/stats.hpp"
+
+#include "rapidjson/encodedstream.h"
+#include "rapidjson/memorystream.h"
+#include "rapidjson/reader.h"
+
+#include <cstring>
 
 namespace jsonify {
 namespace api {
 
+  inline void parse_document( rapidjson::Document& doc, const char* json ) {
+    jsonify::stats::timer t( jsonify::stats::STAGE_PARSE );
+    if( jsonify::stats::enabled() ) {
+      jsonify::stats::count( jsonify::stats::COUNT_BYTES_PARSED, std::strlen( json ) );
+    }
+    doc.Parse( json );
+  }
+
+  // 'json' isn't null-terminated (e.g. a raw vector), and isn't modified
+  inline void parse_document( rapidjson::Document& doc, const char* json, size_t length ) {
+    jsonify::stats::timer t( jsonify::stats::STAGE_PARSE );
+    jsonify::stats::count( jsonify::stats::COUNT_BYTES_PARSED, length );
+    doc.Parse( json, length );
+  }
+
+  // the strings are decoded in place and the document points to them, rather than
+  // copying them into its allocator. See jsonify/from_json/sources.hpp
+  inline void parse_document_insitu( rapidjson::Document& doc, char* json, size_t length ) {
+    jsonify::stats::timer t( jsonify::stats::STAGE_PARSE );
+    jsonify::stats::count( jsonify::stats::COUNT_BYTES_PARSED, length );
+    doc.ParseInsitu( json );
+  }
+
+  // only the selected values are put in the document; the rest are skipped as
+  // they're parsed. See jsonify/from_json/select.hpp
+  template< unsigned parseFlags, typename InputStream >
+  inline void parse_document( rapidjson::Document& doc, InputStream& is, SEXP select ) {
+    jsonify::from_json::select_node root;
+    jsonify::from_json::make_select( select, root );
+    jsonify::from_json::select_generator< parseFlags, InputStream > g( is, root );
+    {
+      jsonify::stats::timer t( jsonify::stats::STAGE_PARSE );
+      doc.Populate( g );
+    }
+    if( !g.ok ) {
+      Rcpp::stop("json parse error");
+    }
+  }
+
   inline SEXP parse_json(const char* json ) {
     
     rapidjson::Document doc;
-    doc.Parse(json);
+    parse_document( doc, json );
     
     // Make sure there were no parse errors
     if(doc.HasParseError()) {
@@ -35,6 +84,11 @@ namespace api {
 
     // If the input is a scalar value of type int, double, string, or bool, 
     // return Rcpp vector with length 1.
+    if( !doc.IsObject() && !doc.IsArray() ) {
+      jsonify::stats::count_value( doc );
+      jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
+    }
+    
     if( doc.IsInt() ) {
       return Rcpp::wrap( doc.GetInt() );
     }
@@ -54,16 +108,139 @@ namespace api {
     return jsonify::from_json::from_json( doc, simplify, fill_na );
   }
 
-  inline SEXP from_json( const char* json, bool& simplify, bool& fill_na ) {
+  // with a schema the columns are known, so nothing is inferred. See
+  // jsonify/from_json/schema.hpp
+  inline SEXP from_json( rapidjson::Value& doc, SEXP schema, bool& simplify, bool& fill_na ) {
+    if( Rf_isNull( schema ) ) {
+      return from_json( doc, simplify, fill_na );
+    }
+    return jsonify::from_json::schema_to_dataframe( doc, schema, simplify, fill_na );
+  }
+
+  inline SEXP from_json(
+      const char* json,
+      bool& simplify,
+      bool& fill_na,
+      SEXP schema = R_NilValue,
+      SEXP select = R_NilValue
+  ) {
     rapidjson::Document doc;
-    doc.Parse(json);
+    if( !Rf_isNull( select ) ) {
+      if( jsonify::stats::enabled() ) {
+        jsonify::stats::count( jsonify::stats::COUNT_BYTES_PARSED, std::strlen( json ) );
+      }
+      rapidjson::StringStream ss( json );
+      parse_document< rapidjson::kParseDefaultFlags >( doc, ss, select );
+      return from_json( doc, schema, simplify, fill_na );
+    }
+    
+    parse_document( doc, json );
 
     // Make sure there were no parse errors
     if(doc.HasParseError()) {
       Rcpp::stop("json parse error");
     }
     
-    return from_json( doc, simplify, fill_na );
+    return from_json( doc, schema, simplify, fill_na );
+  }
+
+  inline SEXP from_json(
+      const char* json,
+      size_t length,
+      bool& simplify,
+      bool& fill_na,
+      SEXP schema = R_NilValue,
+      SEXP select = R_NilValue
+  ) {
+    rapidjson::Document doc;
+    if( !Rf_isNull( select ) ) {
+      jsonify::stats::count( jsonify::stats::COUNT_BYTES_PARSED, length );
+      rapidjson::MemoryStream ms( json, length );
+      rapidjson::EncodedInputStream< rapidjson::UTF8<>, rapidjson::MemoryStream > is( ms );
+      parse_document< rapidjson::kParseDefaultFlags >( doc, is, select );
+      return from_json( doc, schema, simplify, fill_na );
+    }
+    
+    parse_document( doc, json, length );
+
+    if(doc.HasParseError()) {
+      Rcpp::stop("json parse error");
+    }
+    
+    return from_json( doc, schema, simplify, fill_na );
+  }
+
+  // 'json' is parsed in place, so must be writable and null-terminated
+  inline SEXP from_json_insitu(
+      char* json,
+      size_t length,
+      bool& simplify,
+      bool& fill_na,
+      SEXP schema = R_NilValue,
+      SEXP select = R_NilValue
+  ) {
+    rapidjson::Document doc;
+    if( !Rf_isNull( select ) ) {
+      jsonify::stats::count( jsonify::stats::COUNT_BYTES_PARSED, length );
+      rapidjson::InsituStringStream ss( json );
+      parse_document< rapidjson::kParseInsituFlag | rapidjson::kParseDefaultFlags >( doc, ss, select );
+      return from_json( doc, schema, simplify, fill_na );
+    }
+    
+    parse_document_insitu( doc, json, length );
+
+    if(doc.HasParseError()) {
+      Rcpp::stop("json parse error");
+    }
+    
+    return from_json( doc, schema, simplify, fill_na );
+  }
+
+  // from_json() from rapidjson::Reader's events, without a document. The result
+  // is the same. See jsonify/from_json/sax.hpp
+  //
+  // With 'select' the events go through a select_filter, so the values which
+  // aren't selected are never stored
+  template< unsigned parseFlags, typename InputStream >
+  inline SEXP parse_sax( InputStream& is, bool& simplify, bool& fill_na, SEXP select ) {
+    rapidjson::Reader reader;
+    jsonify::from_json::sax_handler handler( simplify, fill_na );
+    if( Rf_isNull( select ) ) {
+      jsonify::stats::timer t( jsonify::stats::STAGE_PARSE );
+      reader.Parse< parseFlags >( is, handler );
+    } else {
+      jsonify::from_json::select_node root;
+      jsonify::from_json::make_select( select, root );
+      jsonify::from_json::select_filter< jsonify::from_json::sax_handler > filter( handler, root );
+      jsonify::stats::timer t( jsonify::stats::STAGE_PARSE );
+      reader.Parse< parseFlags >( is, filter );
+    }
+    if( reader.HasParseError() ) {
+      Rcpp::stop("json parse error");
+    }
+    return handler.result();
+  }
+
+  inline SEXP from_json_sax( const char* json, bool& simplify, bool& fill_na, SEXP select = R_NilValue ) {
+    if( jsonify::stats::enabled() ) {
+      jsonify::stats::count( jsonify::stats::COUNT_BYTES_PARSED, std::strlen( json ) );
+    }
+    rapidjson::StringStream ss( json );
+    return parse_sax< rapidjson::kParseDefaultFlags >( ss, simplify, fill_na, select );
+  }
+
+  inline SEXP from_json_sax( const char* json, size_t length, bool& simplify, bool& fill_na, SEXP select = R_NilValue ) {
+    jsonify::stats::count( jsonify::stats::COUNT_BYTES_PARSED, length );
+    rapidjson::MemoryStream ms( json, length );
+    rapidjson::EncodedInputStream< rapidjson::UTF8<>, rapidjson::MemoryStream > is( ms );
+    return parse_sax< rapidjson::kParseDefaultFlags >( is, simplify, fill_na, select );
+  }
+
+  // the strings are decoded in place, and used from there rather than copied
+  inline SEXP from_json_sax_insitu( char* json, size_t length, bool& simplify, bool& fill_na, SEXP select = R_NilValue ) {
+    jsonify::stats::count( jsonify::stats::COUNT_BYTES_PARSED, length );
+    rapidjson::InsituStringStream ss( json );
+    return parse_sax< rapidjson::kParseInsituFlag | rapidjson::kParseDefaultFlags >( ss, simplify, fill_na, select );
   }
 
   inline SEXP from_ndjson( const char * ndjson, bool& simplify, bool& fill_na ) {
@@ -71,7 +248,7 @@ namespace api {
     // TODO:
     // - if ndjson is a single json object, no need to wrap in `[]` as this will nest it deeper
     rapidjson::Document doc;
-    doc.Parse(ndjson);
+    parse_document( doc, ndjson );
     
     std::string json;
     
@@ -5,6 +5,8 @@
 
 #include "from_json_utils.hpp"
 #include "simplify/simplify.hpp"
+#include "simplify/records.hpp"
+#include "jsonify/stats.hpp"
 
 
 namespace jsonify {
@@ -23,6 +25,7 @@ namespace from_json {
     
     R_xlen_t json_length = json.Size();
     Rcpp::List out( json_length );
+    jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
     
     R_xlen_t i = 0;
     for ( const auto& child : json.GetArray() ) {
@@ -46,6 +49,7 @@ namespace from_json {
     
     Rcpp::List out( json_length );
     Rcpp::CharacterVector names( json_length );
+    jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS, 2 );
     R_xlen_t i = 0;
     
     // https://github.com/Tencent/rapidjson/issues/162#issuecomment-341824061
@@ -75,21 +79,27 @@ namespace from_json {
     
     R_xlen_t json_length = json.Size();
     
+    jsonify::stats::count_value( json );
+    
     switch( json.GetType() ) {
     
     case rapidjson::kNullType: {
+      jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
       return R_NA_VAL;
       break;
     }
     case rapidjson::kFalseType: {}
     case rapidjson::kTrueType: {
+      jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
       return Rcpp::wrap< bool >( json.GetBool() );
     }
     case rapidjson::kStringType: {
+      jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
       return Rcpp::wrap( std::string( json.GetString() ) );
     }
       // numeric
     case rapidjson::kNumberType: {
+      jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
       if( json.IsDouble() ) {
       return Rcpp::wrap< double >( json.GetDouble() );
     } else {
@@ -105,6 +115,9 @@ namespace from_json {
       
       if( simplify && !contains_object_or_array( dtypes ) ) {
         return array_to_vector( json.GetArray(), simplify );
+      } else if( simplify && dtypes.size() == 1 && contains_object( dtypes ) ) {
+        // an array of records
+        return records_to_dataframe( json, dtypes, fill_na );
       } else {
         Rcpp::List arr = parse_array( json, simplify, fill_na );
         if( simplify) {
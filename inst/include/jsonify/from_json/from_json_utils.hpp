@@ -4,6 +4,7 @@
 #include <Rcpp.h>
 
 #include "rapidjson/document.h"
+#include "jsonify/stats.hpp"
 
 #define R_NA_VAL Rcpp::LogicalVector::create(NA_LOGICAL);
 
@@ -32,6 +33,7 @@ namespace from_json {
   template< typename T >
   inline std::unordered_set< int > get_dtypes( T& doc ) {
     
+    jsonify::stats::timer t( jsonify::stats::STAGE_GET_DTYPES );
     std::unordered_set< int > dtypes;
     
     R_xlen_t doc_len = doc.Size();
@@ -162,6 +164,7 @@ namespace from_json {
       R_xlen_t& n_rows
   ) {
     Rcpp::List new_column( n_rows );
+    jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
     columns[ this_column ] = new_column;
   }
   
@@ -171,6 +174,7 @@ namespace from_json {
     R_xlen_t& n_rows
   ) {
     Rcpp::List new_column( n_rows );
+    jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
     // need NAs when fill_na = true;
     R_xlen_t i;
     for( i = 0; i < n_rows; ++i ) {
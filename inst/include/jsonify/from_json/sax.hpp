@@ -0,0 +1,436 @@
+#ifndef R_JSONIFY_FROM_JSON_SAX_H
+#define R_JSONIFY_FROM_JSON_SAX_H
+
+#include <Rcpp.h>
+
+#include "rapidjson/reader.h"
+#include "jsonify/from_json/from_json_utils.hpp"
+#include "jsonify/from_json/simplify/simplify.hpp"
+#include "jsonify/from_json/simplify/records.hpp"
+#include "jsonify/stats.hpp"
+
+#include <climits>
+#include <cstring>
+#include <unordered_set>
+#include <vector>
+
+#define JSONIFY_STRING_BLOCK_SIZE 65536
+#define JSONIFY_SAX_STACK_SIZE 64
+
+// from_json() without a rapidjson::Document. rapidjson::Reader's events build
+// the R objects directly: each open array or object is a frame on a stack, and
+// its values are kept as record_cells (scalars, with strings copied into an
+// arena) until it ends, when the R value is made from them in one go - a vector
+// for an array of scalars, a named list for an object. An array whose values are
+// all objects adds each object to the data.frame columns as a row when it ends,
+// so the rows are never lists. Arrays and objects which have ended are R values,
+// kept on a protected stack until their parent ends.
+//
+// The simplify rules are those of the DOM (jsonify/from_json/from_json.hpp),
+// applied as each array ends using the JSON types seen in it, so the results
+// are identical. Only the JSON being parsed, the open frames and the R values
+// are in memory at once; the strings of a frame are released when it ends.
+
+namespace jsonify {
+namespace from_json {
+
+  // copies of strings which stay where they are until they're released, a mark
+  // at a time. Blocks are kept for reuse
+  class string_arena {
+  public:
+    struct mark {
+      size_t block;
+      size_t used;
+    };
+
+    string_arena() : block_( 0 ), used_( 0 ) {}
+
+    // a null-terminated copy
+    const char* copy( const char* str, size_t length ) {
+      size_t needed = length + 1;
+      if( blocks_.empty() || blocks_[ block_ ].size() - used_ < needed ) {
+        next_block( needed );
+      }
+      char* out = &blocks_[ block_ ][ used_ ];
+      std::memcpy( out, str, length );
+      out[ length ] = '\0';
+      used_ += needed;
+      return out;
+    }
+
+    mark get_mark() const {
+      mark m;
+      m.block = block_;
+      m.used = used_;
+      return m;
+    }
+
+    // the strings copied since 'm' was taken are no longer needed
+    void release( const mark& m ) {
+      block_ = m.block;
+      used_ = m.used;
+    }
+
+  private:
+
+    void next_block( size_t needed ) {
+      size_t size = needed > JSONIFY_STRING_BLOCK_SIZE ? needed : JSONIFY_STRING_BLOCK_SIZE;
+      if( !blocks_.empty() ) {
+        ++block_;
+      }
+      if( block_ == blocks_.size() ) {
+        blocks_.push_back( std::vector< char >( size ) );
+      } else if( blocks_[ block_ ].size() < needed ) {
+        // nothing after the current block is in use
+        blocks_[ block_ ].resize( size );
+      }
+      used_ = 0;
+    }
+
+    std::vector< std::vector< char > > blocks_;
+    size_t block_;
+    size_t used_;
+  };
+
+  // the JSON types of get_dtypes(), as bits
+  enum sax_dtype {
+    DTYPE_NULL = 1 << 0,
+    DTYPE_BOOL = 1 << 1,
+    DTYPE_OBJECT = 1 << 3,
+    DTYPE_ARRAY = 1 << 4,
+    DTYPE_STRING = 1 << 5,
+    DTYPE_INT = 1 << 8,
+    DTYPE_DOUBLE = 1 << 9
+  };
+
+  inline std::unordered_set< int > dtypes_set( int dtypes ) {
+    std::unordered_set< int > out;
+    int i;
+    for( i = 0; i < 10; ++i ) {
+      if( dtypes & ( 1 << i ) ) {
+        out.insert( i );
+      }
+    }
+    return out;
+  }
+
+  class sax_handler : public rapidjson::BaseReaderHandler< rapidjson::UTF8<>, sax_handler > {
+  public:
+
+    sax_handler( bool simplify, bool fill_na )
+      : simplify_( simplify ),
+        fill_na_( fill_na ),
+        depth_( 0 ),
+        values_( JSONIFY_SAX_STACK_SIZE ),
+        n_values_( 0 ),
+        root_( R_NilValue ) {
+      key_.name = NULL;
+      key_.length = 0;
+    }
+
+    bool Null() {
+      record_cell c;
+      c.kind = CELL_NULL;
+      c.value = NULL;
+      jsonify::stats::count( jsonify::stats::COUNT_NULL );
+      return add_scalar( c, DTYPE_NULL );
+    }
+
+    bool Bool( bool b ) {
+      record_cell c;
+      c.kind = CELL_BOOL;
+      c.i = b ? 1 : 0;
+      jsonify::stats::count( jsonify::stats::COUNT_BOOL );
+      return add_scalar( c, DTYPE_BOOL );
+    }
+
+    // numbers outside an int's range which aren't doubles are truncated, as
+    // GetInt() truncates them in the document
+    bool Int( int i ) { return add_int( i ); }
+    bool Uint( unsigned u ) { return add_int( static_cast< int >( u ) ); }
+    bool Int64( int64_t i ) { return add_int( static_cast< int >( i ) ); }
+    bool Uint64( uint64_t u ) { return add_int( static_cast< int >( u ) ); }
+
+    bool Double( double d ) {
+      record_cell c;
+      c.kind = CELL_DOUBLE;
+      c.d = d;
+      jsonify::stats::count( jsonify::stats::COUNT_DOUBLE );
+      return add_scalar( c, DTYPE_DOUBLE );
+    }
+
+    // strings parsed in place ('copy' is false) stay where they are, otherwise
+    // they're in the reader's buffer until the next one
+    bool String( const char* str, rapidjson::SizeType length, bool copy ) {
+      record_cell c;
+      c.kind = CELL_STRING;
+      c.s = copy ? strings_.copy( str, length ) : str;
+      jsonify::stats::count( jsonify::stats::COUNT_STRING );
+      return add_scalar( c, DTYPE_STRING );
+    }
+
+    bool Key( const char* str, rapidjson::SizeType length, bool copy ) {
+      key_.name = copy ? strings_.copy( str, length ) : str;
+      key_.length = length;
+      return true;
+    }
+
+    bool StartObject() {
+      jsonify::stats::count( jsonify::stats::COUNT_OBJECT );
+      push_frame( true );
+      return true;
+    }
+
+    bool EndObject( rapidjson::SizeType n ) {
+      frame& f = frames_[ depth_ - 1 ];
+      const record_key* keys = keys_.data() + f.first_key;
+      const record_cell* cells = cells_.data() + f.first_cell;
+
+      // is it the next row of its parent's data.frame?
+      if( depth_ > 1 ) {
+        frame& parent = frames_[ depth_ - 2 ];
+        if( parent.records ) {
+          if( parent.columns.add( keys, cells, n ) ) {
+            // the rows still use the strings and R values
+            keys_.resize( f.first_key );
+            cells_.resize( f.first_cell );
+            --depth_;
+            parent.dtypes |= DTYPE_OBJECT;
+            return true;
+          }
+        }
+      }
+
+      // parse_object()
+      Rcpp::RObject obj;
+      R_xlen_t n_members = static_cast< R_xlen_t >( n );
+      if( n_members == 0 ) {
+        obj = R_NilValue;
+      } else {
+        Rcpp::List out( n_members );
+        Rcpp::CharacterVector names( n_members );
+        jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS, 2 );
+        R_xlen_t i;
+        for( i = 0; i < n_members; ++i ) {
+          out[ i ] = cell_to_sexp< rapidjson::Value >( cells[ i ], fill_na_ );
+          names[ i ] = std::string( keys[ i ].name );
+        }
+        out.attr("names") = names;
+        obj = out;
+      }
+      pop_frame();
+      return add_value( obj, DTYPE_OBJECT );
+    }
+
+    bool StartArray() {
+      jsonify::stats::count( jsonify::stats::COUNT_ARRAY );
+      if( depth_ > 0 ) {
+        // an array can't be a row
+        spill( frames_[ depth_ - 1 ] );
+      }
+      push_frame( false );
+      return true;
+    }
+
+    bool EndArray( rapidjson::SizeType n ) {
+      frame& f = frames_[ depth_ - 1 ];
+      const record_cell* cells = cells_.data() + f.first_cell;
+      R_xlen_t n_cells = static_cast< R_xlen_t >( cells_.size() - f.first_cell );
+      R_xlen_t i;
+      (void)n;
+
+      Rcpp::RObject arr;
+      if( f.records && f.columns.n_rows() > 0 ) {
+        // every value was an object, and a row
+        jsonify::stats::timer t( jsonify::stats::STAGE_SIMPLIFY_DATAFRAME );
+        arr = f.columns.finish< rapidjson::Value >();
+
+      } else if( simplify_ && ( f.dtypes & ( DTYPE_OBJECT | DTYPE_ARRAY ) ) == 0 ) {
+        // array_to_vector()
+        jsonify::stats::timer t( jsonify::stats::STAGE_ARRAY_TO_VECTOR );
+        if( n_cells == 0 ) {
+          arr = Rcpp::List();
+        } else {
+          int r_type = 0;
+          for( i = 0; i < n_cells; ++i ) {
+            int this_type = cell_r_type( cells[ i ].kind );
+            r_type = this_type > r_type ? this_type : r_type;
+          }
+          arr = scalar_vector( cells, n_cells, r_type );
+        }
+
+      } else {
+        Rcpp::List out( n_cells );
+        jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
+        for( i = 0; i < n_cells; ++i ) {
+          out[ i ] = cell_to_sexp< rapidjson::Value >( cells[ i ], fill_na_ );
+        }
+        if( simplify_ ) {
+          std::unordered_set< int > dtypes = dtypes_set( f.dtypes );
+          arr = jsonify::from_json::simplify( out, dtypes, n_cells, fill_na_ );
+        } else {
+          arr = out;
+        }
+      }
+      pop_frame();
+      return add_value( arr, DTYPE_ARRAY );
+    }
+
+    // the R object, as from_json() makes it from the document. An empty array is
+    // an empty list, and an empty object NULL, at the top-level as anywhere else
+    SEXP result() {
+      return root_;
+    }
+
+  private:
+
+    struct frame {
+      bool is_object;
+      size_t first_cell;
+      size_t first_key;
+      R_xlen_t first_value;
+      string_arena::mark strings;
+      int dtypes;             // the JSON types of the values
+      bool records;           // the values are all objects, added to 'columns' as rows
+      record_columns columns;
+    };
+
+    bool add_int( int i ) {
+      record_cell c;
+      c.kind = CELL_INT;
+      c.i = i;
+      jsonify::stats::count( jsonify::stats::COUNT_INT );
+      return add_scalar( c, DTYPE_INT );
+    }
+
+    bool add_scalar( const record_cell& c, int dtype ) {
+      if( depth_ == 0 ) {
+        root_ = scalar_root( c );
+        return true;
+      }
+      frame& f = frames_[ depth_ - 1 ];
+      if( !f.is_object ) {
+        // a scalar can't be a row
+        spill( f );
+      }
+      push_cell( f, c, dtype );
+      return true;
+    }
+
+    // an array or object which has ended
+    bool add_value( SEXP value, int dtype ) {
+      if( depth_ == 0 ) {
+        root_ = value;
+        return true;
+      }
+      frame& f = frames_[ depth_ - 1 ];
+      record_cell c;
+      c.kind = CELL_SEXP;
+      c.sexp = protect( value );
+      if( !f.is_object ) {
+        // an object which couldn't be a row, or an array
+        spill( f );
+      }
+      push_cell( f, c, dtype );
+      return true;
+    }
+
+    void push_cell( frame& f, const record_cell& c, int dtype ) {
+      f.dtypes |= dtype;
+      cells_.push_back( c );
+      if( f.is_object ) {
+        keys_.push_back( key_ );
+      }
+    }
+
+    // a scalar document, as jsonify::api::from_json() returns it
+    SEXP scalar_root( const record_cell& c ) {
+      jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
+      switch( c.kind ) {
+      case CELL_NULL: {
+        return R_NilValue;
+      }
+      case CELL_STRING: {
+        return Rcpp::wrap( Rcpp::String( c.s ) );
+      }
+      default: {
+        return cell_to_sexp< rapidjson::Value >( c, fill_na_ );
+      }
+      }
+    }
+
+    void push_frame( bool is_object ) {
+      if( depth_ == frames_.size() ) {
+        frames_.push_back( frame() );
+      }
+      frame& f = frames_[ depth_++ ];
+      f.is_object = is_object;
+      f.first_cell = cells_.size();
+      f.first_key = keys_.size();
+      f.first_value = n_values_;
+      f.strings = strings_.get_mark();
+      f.dtypes = 0;
+      f.records = !is_object && simplify_;
+      if( f.records ) {
+        f.columns.reset( fill_na_ );
+      }
+    }
+
+    // the frame's cells, strings and R values are no longer needed
+    void pop_frame() {
+      frame& f = frames_[ --depth_ ];
+      cells_.resize( f.first_cell );
+      keys_.resize( f.first_key );
+      strings_.release( f.strings );
+      n_values_ = f.first_value;
+    }
+
+    // the array's values aren't all objects, so the rows it has are made into
+    // the lists parse_array() would have made
+    void spill( frame& f ) {
+      if( !f.records ) {
+        return;
+      }
+      f.records = false;
+      R_xlen_t n_rows = f.columns.n_rows();
+      R_xlen_t r;
+      for( r = 0; r < n_rows; ++r ) {
+        record_cell c;
+        c.kind = CELL_SEXP;
+        c.sexp = protect( f.columns.row< rapidjson::Value >( r ) );
+        cells_.push_back( c );
+      }
+      f.columns.reset( fill_na_ );
+    }
+
+    // keeps 'value' on the stack of R values until its frame ends
+    SEXP protect( SEXP value ) {
+      if( n_values_ == values_.size() ) {
+        Rcpp::List grown( values_.size() * 2 );
+        R_xlen_t i;
+        for( i = 0; i < n_values_; ++i ) {
+          SET_VECTOR_ELT( grown, i, VECTOR_ELT( values_, i ) );
+        }
+        values_ = grown;
+      }
+      SET_VECTOR_ELT( values_, n_values_++, value );
+      return value;
+    }
+
+    bool simplify_;
+    bool fill_na_;
+    std::vector< frame > frames_;
+    size_t depth_;
+    std::vector< record_cell > cells_;   // the values of the open frames
+    std::vector< record_key > keys_;     // and the keys of the open objects
+    record_key key_;
+    string_arena strings_;
+    Rcpp::List values_;
+    R_xlen_t n_values_;
+    Rcpp::RObject root_;
+  };
+
+} // namespace from_json
+} // namespace jsonify
+
+#endif
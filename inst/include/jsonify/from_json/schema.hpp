@@ -0,0 +1,481 @@
+#ifndef R_JSONIFY_FROM_JSON_SCHEMA_H
+#define R_JSONIFY_FROM_JSON_SCHEMA_H
+
+#include <Rcpp.h>
+
+#include "rapidjson/document.h"
+#include "jsonify/from_json/from_json_utils.hpp"
+#include "jsonify/from_json/simplify/simplify.hpp"
+#include "jsonify/stats.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#define JSONIFY_SCHEMA_SCAN_FIELDS 8
+
+// from_json( schema = ) : records (objects) read into a data.frame whose columns
+// are described up-front by a prototype, e.g.
+//
+//   list( id = integer(), loc = list( lat = numeric(), lon = numeric() ), tags = list() )
+//
+// so nothing is inferred. The columns are allocated once, at their full length
+// (the number of records), filled with NA, and each value is written straight
+// into its column. Keys which aren't in the schema are never looked at.
+//
+// A value is coerced to its column's type where that loses nothing (e.g. an int
+// in a numeric column, a whole double in an integer column, a number in a
+// character column, as as.character() would). A value which can't be is left NA,
+// and counted, and reported in a warning once the data.frame is made.
+
+namespace jsonify {
+namespace from_json {
+
+  template< typename T > SEXP parse_json( const T& json, bool simplify, bool fill_na );
+
+  enum field_kind {
+    FIELD_VECTOR,
+    FIELD_MATRIX,
+    FIELD_LIST,
+    FIELD_DATAFRAME
+  };
+
+  struct schema_field {
+    std::string name;
+    field_kind kind;
+    int r_type;                           // of a vector or matrix
+    R_xlen_t n_col;                       // of a matrix
+    std::vector< schema_field > fields;   // of a data.frame
+    std::unordered_map< std::string, size_t > index;
+  };
+
+  // the fields of a data.frame (a named list, or a data.frame) prototype
+  inline void make_schema( SEXP proto, schema_field& schema ) {
+    R_xlen_t n = Rf_xlength( proto );
+    R_xlen_t i;
+    SEXP names = Rf_getAttrib( proto, R_NamesSymbol );
+
+    schema.kind = FIELD_DATAFRAME;
+    schema.r_type = VECSXP;
+    schema.n_col = 0;
+    schema.fields.resize( n );
+
+    for( i = 0; i < n; ++i ) {
+      SEXP el = VECTOR_ELT( proto, i );
+      schema_field& f = schema.fields[ i ];
+      f.name = CHAR( STRING_ELT( names, i ) );
+      if( f.name.empty() || schema.index.find( f.name ) != schema.index.end() ) {
+        Rcpp::stop("jsonify - schema fields need unique names");
+      }
+      schema.index[ f.name ] = i;
+      f.r_type = TYPEOF( el );
+      f.n_col = 0;
+
+      if( f.r_type == VECSXP ) {
+        SEXP el_names = Rf_getAttrib( el, R_NamesSymbol );
+        if( Rf_xlength( el ) > 0 && !Rf_isNull( el_names ) ) {
+          make_schema( el, f );
+        } else {
+          f.kind = FIELD_LIST;
+        }
+        continue;
+      }
+
+      if( Rf_isFactor( el ) ||
+          ( f.r_type != LGLSXP && f.r_type != INTSXP && f.r_type != REALSXP && f.r_type != STRSXP ) ) {
+        Rcpp::stop(
+          "jsonify - schema field '%s' must be a logical, integer, numeric or character vector or matrix, a list, or a named list",
+          f.name
+        );
+      }
+      if( Rf_isMatrix( el ) ) {
+        f.kind = FIELD_MATRIX;
+        f.n_col = Rf_ncols( el );
+        if( f.n_col < 1 ) {
+          Rcpp::stop("jsonify - schema field '%s' is a matrix without any columns", f.name );
+        }
+      } else {
+        f.kind = FIELD_VECTOR;
+      }
+    }
+  }
+
+  // the values which didn't match the schema
+  struct schema_report {
+    R_xlen_t n;
+    R_xlen_t row;
+    std::string path;
+
+    schema_report() : n( 0 ), row( 0 ) {}
+
+    void mismatch( R_xlen_t this_row, const std::string& prefix, const std::string& name ) {
+      if( n++ == 0 ) {
+        row = this_row;
+        path = prefix + "/" + name;
+      }
+    }
+  };
+
+  // the columns of a data.frame, preallocated for 'n_rows' records
+  class schema_table {
+  public:
+
+    schema_table(
+      const schema_field& schema,
+      R_xlen_t n_rows,
+      bool simplify,
+      bool fill_na,
+      const std::string& prefix,
+      schema_report& report
+    ) : schema_( schema ),
+        n_rows_( n_rows ),
+        simplify_( simplify ),
+        fill_na_( fill_na ),
+        prefix_( prefix ),
+        report_( report ),
+        slots_( schema.fields.size() ),
+        last_field_( 0 ) {
+
+      size_t j;
+      R_xlen_t i;
+      for( j = 0; j < slots_.size(); ++j ) {
+        const schema_field& f = schema_.fields[ j ];
+        slot& s = slots_[ j ];
+        s.last_row = -1;
+
+        switch( f.kind ) {
+        case FIELD_DATAFRAME: {
+          s.table.reset( new schema_table( f, n_rows_, simplify_, fill_na_, prefix_ + "/" + f.name, report_ ) );
+          continue;
+        }
+        case FIELD_LIST: {
+          Rcpp::List lst( n_rows_ );
+          Rcpp::LogicalVector na = R_NA_VAL;
+          for( i = 0; i < n_rows_; ++i ) {
+            SET_VECTOR_ELT( lst, i, na );
+          }
+          s.values = lst;
+          break;
+        }
+        case FIELD_MATRIX: {
+          s.values = Rf_allocMatrix( f.r_type, n_rows_, f.n_col );
+          fill_with_na( s.values, f.r_type );
+          break;
+        }
+        default: {
+          s.values = Rf_allocVector( f.r_type, n_rows_ );
+          fill_with_na( s.values, f.r_type );
+        }
+        }
+        jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
+      }
+    }
+
+    // writes the fields of 'record' (an object) into row 'row'
+    template< typename T >
+    void add( const T& record, R_xlen_t row ) {
+      for( const auto& member : record.GetObject() ) {
+        size_t j = find_field( member.name.GetString(), member.name.GetStringLength() );
+        if( j == npos() ) {
+          continue;
+        }
+        slot& s = slots_[ j ];
+        if( s.last_row == row ) {
+          // a duplicate key; the first is used
+          continue;
+        }
+        s.last_row = row;
+        set_field( schema_.fields[ j ], s, member.value, row );
+      }
+    }
+
+    // the data.frame
+    SEXP finish() {
+      size_t n_cols = slots_.size();
+      size_t j;
+      Rcpp::List df( n_cols );
+      Rcpp::StringVector names( n_cols );
+      jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS, 2 );
+      for( j = 0; j < n_cols; ++j ) {
+        slot& s = slots_[ j ];
+        if( s.table ) {
+          df[ j ] = s.table -> finish();
+        } else {
+          convert_numbers( s );
+          df[ j ] = s.values;
+        }
+        names[ j ] = schema_.fields[ j ].name;
+      }
+      df.attr("names") = names;
+      return make_dataframe( df, n_rows_ );
+    }
+
+  private:
+    schema_table( const schema_table& );
+    schema_table& operator=( const schema_table& );
+
+    struct slot {
+      Rcpp::RObject values;
+      std::unique_ptr< schema_table > table;
+      // numbers in a character column, converted with as.character() at the end
+      std::vector< std::pair< R_xlen_t, int > > ints;
+      std::vector< std::pair< R_xlen_t, double > > doubles;
+      R_xlen_t last_row;
+    };
+
+    static size_t npos() { return static_cast< size_t >( -1 ); }
+
+    static void fill_with_na( SEXP x, int r_type ) {
+      R_xlen_t n = Rf_xlength( x );
+      R_xlen_t i;
+      switch( r_type ) {
+      case LGLSXP: {
+        std::fill( LOGICAL( x ), LOGICAL( x ) + n, NA_LOGICAL );
+        break;
+      }
+      case INTSXP: {
+        std::fill( INTEGER( x ), INTEGER( x ) + n, NA_INTEGER );
+        break;
+      }
+      case REALSXP: {
+        std::fill( REAL( x ), REAL( x ) + n, NA_REAL );
+        break;
+      }
+      default: {
+        for( i = 0; i < n; ++i ) {
+          SET_STRING_ELT( x, i, NA_STRING );
+        }
+      }
+      }
+    }
+
+    // the keys are usually in the same order as the fields, and often there are
+    // only a few fields, which are quicker to compare than to hash
+    size_t find_field( const char* key, rapidjson::SizeType length ) {
+      size_t n = schema_.fields.size();
+      size_t j;
+      size_t next = last_field_ + 1 < n ? last_field_ + 1 : 0;
+      if( is_field( next, key, length ) ) {
+        return last_field_ = next;
+      }
+      if( n <= JSONIFY_SCHEMA_SCAN_FIELDS ) {
+        for( j = 0; j < n; ++j ) {
+          if( is_field( j, key, length ) ) {
+            return last_field_ = j;
+          }
+        }
+        return npos();
+      }
+      std::unordered_map< std::string, size_t >::const_iterator it = schema_.index.find( std::string( key, length ) );
+      if( it == schema_.index.end() ) {
+        return npos();
+      }
+      return last_field_ = it->second;
+    }
+
+    bool is_field( size_t j, const char* key, rapidjson::SizeType length ) const {
+      const std::string& name = schema_.fields[ j ].name;
+      return name.size() == length && std::memcmp( name.data(), key, length ) == 0;
+    }
+
+    template< typename T >
+    void set_field( const schema_field& f, slot& s, const T& value, R_xlen_t row ) {
+      switch( f.kind ) {
+      case FIELD_VECTOR: {
+        if( !set_scalar( s, f.r_type, row, value ) ) {
+          report_.mismatch( row, prefix_, f.name );
+        }
+        break;
+      }
+      case FIELD_MATRIX: {
+        if( value.IsNull() ) {
+          break;
+        }
+        if( !value.IsArray() || static_cast< R_xlen_t >( value.Size() ) != f.n_col ) {
+          report_.mismatch( row, prefix_, f.name );
+          break;
+        }
+        R_xlen_t j = 0;
+        for( const auto& child : value.GetArray() ) {
+          if( !set_scalar( s, f.r_type, row + j * n_rows_, child ) ) {
+            report_.mismatch( row, prefix_, f.name );
+          }
+          ++j;
+        }
+        break;
+      }
+      case FIELD_LIST: {
+        SET_VECTOR_ELT( s.values, row, parse_json( value, simplify_, fill_na_ ) );
+        break;
+      }
+      default: {
+        if( value.IsObject() ) {
+          s.table -> add( value, row );
+        } else if( !value.IsNull() ) {
+          report_.mismatch( row, prefix_, f.name );
+        }
+      }
+      }
+    }
+
+    // writes a scalar to 'values[ idx ]'. Returns false if it can't be the
+    // column's type (the value stays NA)
+    template< typename T >
+    bool set_scalar( slot& s, int r_type, R_xlen_t idx, const T& value ) {
+      SEXP x = s.values;
+      switch( value.GetType() ) {
+      case rapidjson::kNullType: {
+        jsonify::stats::count( jsonify::stats::COUNT_NULL );
+        return true;
+      }
+      case rapidjson::kFalseType:
+      case rapidjson::kTrueType: {
+        jsonify::stats::count( jsonify::stats::COUNT_BOOL );
+        int b = value.GetBool() ? 1 : 0;
+        switch( r_type ) {
+        case LGLSXP: LOGICAL( x )[ idx ] = b; return true;
+        case INTSXP: INTEGER( x )[ idx ] = b; return true;
+        case REALSXP: REAL( x )[ idx ] = b; return true;
+        default: SET_STRING_ELT( x, idx, Rf_mkChar( b ? "TRUE" : "FALSE" ) ); return true;
+        }
+      }
+      case rapidjson::kNumberType: {
+        bool is_int = value.IsInt();
+        jsonify::stats::count( is_int ? jsonify::stats::COUNT_INT : jsonify::stats::COUNT_DOUBLE );
+        switch( r_type ) {
+        case LGLSXP: {
+          return false;
+        }
+        case INTSXP: {
+          if( is_int ) {
+            INTEGER( x )[ idx ] = value.GetInt();
+            return true;
+          }
+          double d = value.GetDouble();
+          if( d == std::floor( d ) && d > INT_MIN && d <= INT_MAX ) {
+            INTEGER( x )[ idx ] = static_cast< int >( d );
+            return true;
+          }
+          return false;
+        }
+        case REALSXP: {
+          REAL( x )[ idx ] = is_int ? static_cast< double >( value.GetInt() ) : value.GetDouble();
+          return true;
+        }
+        default: {
+          if( is_int ) {
+            s.ints.push_back( std::make_pair( idx, value.GetInt() ) );
+          } else {
+            s.doubles.push_back( std::make_pair( idx, value.GetDouble() ) );
+          }
+          return true;
+        }
+        }
+      }
+      case rapidjson::kStringType: {
+        jsonify::stats::count( jsonify::stats::COUNT_STRING );
+        if( r_type != STRSXP ) {
+          return false;
+        }
+        SET_STRING_ELT( x, idx, Rf_mkCharCE( value.GetString(), CE_UTF8 ) );
+        return true;
+      }
+      default: {
+        return false;
+      }
+      }
+    }
+
+    // as list_to_vector< STRSXP >() converts numbers
+    static void convert_numbers( slot& s ) {
+      size_t i;
+      if( !s.ints.empty() ) {
+        Rcpp::IntegerVector ints( s.ints.size() );
+        for( i = 0; i < s.ints.size(); ++i ) {
+          ints[ i ] = s.ints[ i ].second;
+        }
+        Rcpp::StringVector strs = Rcpp::as< Rcpp::StringVector >( ints );
+        for( i = 0; i < s.ints.size(); ++i ) {
+          SET_STRING_ELT( s.values, s.ints[ i ].first, STRING_ELT( strs, i ) );
+        }
+      }
+      if( !s.doubles.empty() ) {
+        Rcpp::NumericVector dbls( s.doubles.size() );
+        for( i = 0; i < s.doubles.size(); ++i ) {
+          dbls[ i ] = s.doubles[ i ].second;
+        }
+        Rcpp::StringVector strs = Rcpp::as< Rcpp::StringVector >( dbls );
+        for( i = 0; i < s.doubles.size(); ++i ) {
+          SET_STRING_ELT( s.values, s.doubles[ i ].first, STRING_ELT( strs, i ) );
+        }
+      }
+    }
+
+    const schema_field& schema_;
+    R_xlen_t n_rows_;
+    bool simplify_;
+    bool fill_na_;
+    std::string prefix_;
+    schema_report& report_;
+    std::vector< slot > slots_;
+    size_t last_field_;
+  };
+
+  // 'json' is an array of records, or one record. Anything else in the array is
+  // a row of NAs, and reported unless it's null
+  template< typename T >
+  inline SEXP schema_to_dataframe( const T& json, SEXP schema, bool simplify, bool fill_na ) {
+
+    jsonify::stats::timer t( jsonify::stats::STAGE_SIMPLIFY_DATAFRAME );
+
+    if( TYPEOF( schema ) != VECSXP || Rf_xlength( schema ) == 0 || Rf_isNull( Rf_getAttrib( schema, R_NamesSymbol ) ) ) {
+      Rcpp::stop("jsonify - schema must be a named list or a data.frame");
+    }
+    if( !json.IsArray() && !json.IsObject() ) {
+      Rcpp::stop("jsonify - a schema needs an array of objects, or an object");
+    }
+
+    schema_field fields;
+    make_schema( schema, fields );
+
+    schema_report report;
+    R_xlen_t n_rows = json.IsArray() ? static_cast< R_xlen_t >( json.Size() ) : 1;
+    schema_table table( fields, n_rows, simplify, fill_na, "", report );
+
+    if( json.IsObject() ) {
+      jsonify::stats::count( jsonify::stats::COUNT_OBJECT );
+      table.add( json, 0 );
+    } else {
+      R_xlen_t i = 0;
+      jsonify::stats::count( jsonify::stats::COUNT_ARRAY );
+      for( const auto& record : json.GetArray() ) {
+        if( record.IsObject() ) {
+          jsonify::stats::count( jsonify::stats::COUNT_OBJECT );
+          table.add( record, i );
+        } else if( !record.IsNull() ) {
+          report.mismatch( i, "", "" );
+        }
+        ++i;
+      }
+    }
+
+    Rcpp::List df = table.finish();
+    if( report.n > 0 ) {
+      Rcpp::warning(
+        "jsonify - %d value(s) didn't match the schema and are NA; the first is '%s' in record %d",
+        report.n, report.path, report.row + 1
+      );
+    }
+    return df;
+  }
+
+} // namespace from_json
+} // namespace jsonify
+
+#endif
@@ -0,0 +1,378 @@
+#ifndef R_JSONIFY_FROM_JSON_SELECT_H
+#define R_JSONIFY_FROM_JSON_SELECT_H
+
+#include <Rcpp.h>
+
+#include "rapidjson/reader.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// from_json( select = ) : only the values at the selected paths are kept. The
+// paths are JSON Pointers, e.g. "/user/name", where a "*" token is any key of an
+// object or any element of an array, e.g. "/items/*/price". When the JSON is an
+// array the paths are of each of its elements (records).
+//
+// The paths make a tree of select_nodes, which filters rapidjson::Reader's events
+// before they reach the handler - the sax_handler, or a Document (through
+// Document::Populate()) - so the values which aren't selected are skipped as
+// they're parsed, and are never stored, let alone converted to R.
+//
+// A value is kept if its path is selected (with everything in it), or it's an
+// object or array on the way to a selected path (with only what's selected in
+// it). Anything else is dropped, so from_json() gives what it would for JSON
+// which only had the selected values.
+
+namespace jsonify {
+namespace from_json {
+
+  struct select_node {
+    std::string name;
+    bool leaf;                           // everything under here is selected
+    std::vector< select_node > children; // by name; a "*" child is 'wildcard'
+    int wildcard;                        // index of the "*" child, or -1
+
+    select_node() : leaf( false ), wildcard( -1 ) {}
+
+    select_node& child( const std::string& token ) {
+      size_t i;
+      for( i = 0; i < children.size(); ++i ) {
+        if( children[ i ].name == token ) {
+          return children[ i ];
+        }
+      }
+      children.push_back( select_node() );
+      children.back().name = token;
+      if( token == "*" ) {
+        wildcard = static_cast< int >( children.size() - 1 );
+      }
+      return children.back();
+    }
+
+    // the child for a key or an array index, or NULL
+    const select_node* find( const char* key, rapidjson::SizeType length ) const {
+      size_t i;
+      for( i = 0; i < children.size(); ++i ) {
+        const std::string& n = children[ i ].name;
+        if( static_cast< int >( i ) != wildcard && n.size() == length && std::memcmp( n.data(), key, length ) == 0 ) {
+          return &children[ i ];
+        }
+      }
+      return wildcard < 0 ? NULL : &children[ wildcard ];
+    }
+
+    bool has_names() const {
+      return children.size() > ( wildcard < 0 ? 0u : 1u );
+    }
+
+    // adds everything selected under 'other' to this node
+    void merge( const select_node& other ) {
+      size_t i;
+      leaf = leaf || other.leaf;
+      for( i = 0; i < other.children.size(); ++i ) {
+        child( other.children[ i ].name ).merge( other.children[ i ] );
+      }
+    }
+
+    // a key matching a named child also matches "*", so the named child gets
+    // everything the wildcard selects, and a key only needs to find one child
+    void expand() {
+      size_t i;
+      if( wildcard >= 0 ) {
+        select_node w = children[ wildcard ];
+        for( i = 0; i < children.size(); ++i ) {
+          if( static_cast< int >( i ) != wildcard ) {
+            children[ i ].merge( w );
+          }
+        }
+      }
+      for( i = 0; i < children.size(); ++i ) {
+        children[ i ].expand();
+      }
+    }
+  };
+
+  // the tokens of a JSON Pointer, with "~1" and "~0" unescaped
+  inline void add_select_path( select_node& root, const char* path ) {
+    select_node* node = &root;
+    const char* p = path;
+
+    if( *p != '\0' && *p != '/' ) {
+      Rcpp::stop("jsonify - select paths are JSON Pointers, which start with '/', e.g. \"/id\"");
+    }
+    while( *p == '/' ) {
+      std::string token;
+      ++p;
+      while( *p != '\0' && *p != '/' ) {
+        if( *p == '~' ) {
+          ++p;
+          if( *p == '0' ) {
+            token += '~';
+          } else if( *p == '1' ) {
+            token += '/';
+          } else {
+            Rcpp::stop("jsonify - invalid select path %s; '~' must be followed by 0 or 1", path );
+          }
+        } else {
+          token += *p;
+        }
+        ++p;
+      }
+      node = &node -> child( token );
+    }
+    node -> leaf = true;
+  }
+
+  inline void make_select( SEXP paths, select_node& root ) {
+    R_xlen_t n = Rf_xlength( paths );
+    R_xlen_t i;
+    if( TYPEOF( paths ) != STRSXP || n == 0 ) {
+      Rcpp::stop("jsonify - select must be a character vector of JSON Pointers");
+    }
+    for( i = 0; i < n; ++i ) {
+      SEXP path = STRING_ELT( paths, i );
+      if( path == NA_STRING ) {
+        Rcpp::stop("jsonify - select paths can't be NA");
+      }
+      add_select_path( root, CHAR( path ) );
+    }
+    root.expand();
+  }
+
+  // forwards the events of the selected values to 'Handler'
+  template< typename Handler >
+  class select_filter : public rapidjson::BaseReaderHandler< rapidjson::UTF8<>, select_filter< Handler > > {
+  public:
+
+    select_filter( Handler& handler, const select_node& root ) :
+      handler_( handler ),
+      root_( root ),
+      skip_depth_( 0 ),
+      keep_depth_( 0 ),
+      key_( NULL ),
+      key_length_( 0 ),
+      key_is_copy_( false ),
+      n_( 0 ) {}
+
+    bool Null() {
+      return scalar() ? handler_.Null() : true;
+    }
+
+    bool Bool( bool b ) {
+      return scalar() ? handler_.Bool( b ) : true;
+    }
+
+    bool Int( int i ) {
+      return scalar() ? handler_.Int( i ) : true;
+    }
+
+    bool Uint( unsigned u ) {
+      return scalar() ? handler_.Uint( u ) : true;
+    }
+
+    bool Int64( int64_t i ) {
+      return scalar() ? handler_.Int64( i ) : true;
+    }
+
+    bool Uint64( uint64_t u ) {
+      return scalar() ? handler_.Uint64( u ) : true;
+    }
+
+    bool Double( double d ) {
+      return scalar() ? handler_.Double( d ) : true;
+    }
+
+    bool String( const char* str, rapidjson::SizeType length, bool copy ) {
+      return scalar() ? handler_.String( str, length, copy ) : true;
+    }
+
+    bool Key( const char* str, rapidjson::SizeType length, bool copy ) {
+      if( skip_depth_ > 0 ) {
+        return true;
+      }
+      if( keep_depth_ > 0 ) {
+        return handler_.Key( str, length, copy );
+      }
+      // the key is only passed on with its value, if that's kept. A string which
+      // isn't copied is in the (insitu) JSON, and stays there
+      frame& f = frames_.back();
+      f.next = f.node -> find( str, length );
+      if( f.next != NULL ) {
+        if( copy ) {
+          key_copy_.assign( str, length );
+          key_ = key_copy_.data();
+        } else {
+          key_ = str;
+        }
+        key_length_ = length;
+        key_is_copy_ = copy;
+      }
+      return true;
+    }
+
+    bool StartObject() {
+      return start( true ) ? handler_.StartObject() : true;
+    }
+
+    bool EndObject( rapidjson::SizeType n ) {
+      return end( n ) ? handler_.EndObject( n_ ) : true;
+    }
+
+    bool StartArray() {
+      return start( false ) ? handler_.StartArray() : true;
+    }
+
+    bool EndArray( rapidjson::SizeType n ) {
+      return end( n ) ? handler_.EndArray( n_ ) : true;
+    }
+
+  private:
+
+    struct frame {
+      const select_node* node;
+      const select_node* next;  // of the current key
+      bool is_object;
+      bool records;             // the top-level array; its elements are at 'node'
+      rapidjson::SizeType index;
+      rapidjson::SizeType n;    // values passed on
+    };
+
+    // the node of the value starting now, or NULL if it isn't selected. Its
+    // key is passed on when the value is
+    const select_node* next_node() {
+      if( frames_.empty() ) {
+        return &root_;
+      }
+      frame& f = frames_.back();
+      if( f.is_object ) {
+        return f.next;
+      }
+      rapidjson::SizeType i = f.index++;
+      if( f.records ) {
+        return f.node;
+      }
+      if( !f.node -> has_names() ) {
+        return f.node -> wildcard < 0 ? NULL : &f.node -> children[ f.node -> wildcard ];
+      }
+      char idx[ 16 ];
+      int length = std::snprintf( idx, sizeof( idx ), "%u", static_cast< unsigned >( i ) );
+      return f.node -> find( idx, static_cast< rapidjson::SizeType >( length ) );
+    }
+
+    // neither handler stops the parse, so a key is always taken
+    void pass_key() {
+      frame& f = frames_.back();
+      ++f.n;
+      if( f.is_object ) {
+        handler_.Key( key_, key_length_, key_is_copy_ );
+      }
+    }
+
+    // whether a scalar is passed on
+    bool scalar() {
+      if( skip_depth_ > 0 ) {
+        return false;
+      }
+      if( keep_depth_ > 0 ) {
+        return true;
+      }
+      const select_node* node = next_node();
+      if( frames_.empty() ) {
+        // there's nothing to select from
+        return true;
+      }
+      if( node == NULL || !node -> leaf ) {
+        return false;
+      }
+      pass_key();
+      return true;
+    }
+
+    // whether the start of an array or object is passed on
+    bool start( bool is_object ) {
+      if( skip_depth_ > 0 ) {
+        ++skip_depth_;
+        return false;
+      }
+      if( keep_depth_ > 0 ) {
+        ++keep_depth_;
+        return true;
+      }
+      bool top = frames_.empty();
+      const select_node* node = next_node();
+      if( node == NULL ) {
+        skip_depth_ = 1;
+        return false;
+      }
+      if( !top ) {
+        pass_key();
+      }
+      if( node -> leaf ) {
+        keep_depth_ = 1;
+        return true;
+      }
+      frame f;
+      f.node = node;
+      f.next = NULL;
+      f.is_object = is_object;
+      f.records = top && !is_object;
+      f.index = 0;
+      f.n = 0;
+      frames_.push_back( f );
+      return true;
+    }
+
+    // whether the end of an array or object is passed on, with its length in n_
+    bool end( rapidjson::SizeType n ) {
+      if( skip_depth_ > 0 ) {
+        --skip_depth_;
+        return false;
+      }
+      if( keep_depth_ > 0 ) {
+        --keep_depth_;
+        n_ = n;
+        return true;
+      }
+      n_ = frames_.back().n;
+      frames_.pop_back();
+      return true;
+    }
+
+    Handler& handler_;
+    const select_node& root_;
+    std::vector< frame > frames_;
+    size_t skip_depth_;
+    size_t keep_depth_;
+    const char* key_;
+    rapidjson::SizeType key_length_;
+    bool key_is_copy_;
+    std::string key_copy_;
+    rapidjson::SizeType n_;
+  };
+
+  // parses 'is' into a rapidjson::Document (with Document::Populate()), through
+  // a select_filter
+  template< unsigned parseFlags, typename InputStream >
+  struct select_generator {
+    InputStream& is;
+    const select_node& select;
+    bool ok;
+
+    select_generator( InputStream& stream, const select_node& root ) :
+      is( stream ), select( root ), ok( false ) {}
+
+    template< typename Handler >
+    bool operator()( Handler& handler ) {
+      rapidjson::Reader reader;
+      select_filter< Handler > filter( handler, select );
+      ok = !reader.Parse< parseFlags >( is, filter ).IsError();
+      return ok;
+    }
+  };
+
+} // namespace from_json
+} // namespace jsonify
+
+#endif
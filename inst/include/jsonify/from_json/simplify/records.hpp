@@ -0,0 +1,527 @@
+#ifndef R_JSONIFY_FROM_JSON_RECORDS_H
+#define R_JSONIFY_FROM_JSON_RECORDS_H
+
+#include <Rcpp.h>
+
+#include "rapidjson/document.h"
+#include "jsonify/from_json/from_json_utils.hpp"
+#include "jsonify/from_json/simplify/simplify.hpp"
+#include "jsonify/stats.hpp"
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// An array of records (objects) is simplified to a data.frame one record at a
+// time, rather than parsing every record into a named list and then moving each
+// value into a list-column one at a time.
+//
+// Each column collects its cells in a C++ builder as the records are added:
+// scalars are kept as they are (strings as pointers to the parsed JSON), and the
+// R type they'll be promoted to is tracked as they're added, so the R column is
+// made once, at the end, already the right type. A column which holds arrays or
+// objects keeps them (as pointers into the document, or as the R values already
+// made from them), and they're made into a list-column which is finished by the
+// list simplifiers, exactly as before.
+//
+// The result is the same as parse_array() followed by simplify(). When that
+// wouldn't make a data.frame (e.g. the records have different keys and fill_na
+// is false), or a record has a duplicate key, record_columns::add() refuses the
+// record, and the records are made into lists and simplified as before.
+
+namespace jsonify {
+namespace from_json {
+
+  template< typename T > SEXP parse_json( const T& json, bool simplify, bool fill_na );
+  template< typename T > SEXP parse_array( const T& json, bool simplify, bool fill_na );
+
+  enum cell_kind {
+    CELL_MISSING,   // the record doesn't have the key (fill_na)
+    CELL_NULL,
+    CELL_BOOL,
+    CELL_INT,
+    CELL_DOUBLE,
+    CELL_STRING,
+    CELL_VALUE,     // an array or object in the document
+    CELL_SEXP       // an array or object already made in R (and protected elsewhere)
+  };
+
+  struct record_cell {
+    cell_kind kind;
+    union {
+      int i;
+      double d;
+      const char* s;  // null-terminated
+      const void* value;
+      SEXP sexp;
+    };
+  };
+
+  struct record_key {
+    const char* name;  // null-terminated
+    rapidjson::SizeType length;
+  };
+
+  // the R type parse_json() gives a scalar
+  inline int cell_r_type( cell_kind kind ) {
+    switch( kind ) {
+    case CELL_INT: return INTSXP;
+    case CELL_DOUBLE: return REALSXP;
+    case CELL_STRING: return STRSXP;
+    default: return LGLSXP;
+    }
+  }
+
+  // the R value parse_json() gives a cell. 'T' is the document's value type
+  template< typename T >
+  inline SEXP cell_to_sexp( const record_cell& c, bool fill_na ) {
+    switch( c.kind ) {
+    case CELL_BOOL: {
+      return Rcpp::wrap< bool >( c.i != 0 );
+    }
+    case CELL_INT: {
+      return Rcpp::wrap< int >( c.i );
+    }
+    case CELL_DOUBLE: {
+      return Rcpp::wrap< double >( c.d );
+    }
+    case CELL_STRING: {
+      return Rcpp::wrap( std::string( c.s ) );
+    }
+    case CELL_VALUE: {
+      return parse_json( *static_cast< const T* >( c.value ), true, fill_na );
+    }
+    case CELL_SEXP: {
+      return c.sexp;
+    }
+    default: {
+      return R_NA_VAL;
+    }
+    }
+  }
+
+  // scalars, coerced to 'RTYPE' as list_to_vector() and simplify_vector() would
+  template< int RTYPE >
+  inline SEXP scalar_vector( const record_cell* cells, R_xlen_t n ) {
+    R_xlen_t i;
+    Rcpp::Vector< RTYPE > v( n );
+    jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
+    for( i = 0; i < n; ++i ) {
+      const record_cell& c = cells[ i ];
+      switch( c.kind ) {
+      case CELL_BOOL: {}
+      case CELL_INT: {
+        v[ i ] = c.i;
+        break;
+      }
+      case CELL_DOUBLE: {
+        v[ i ] = c.d;
+        break;
+      }
+      default: {
+        v[ i ] = Rcpp::Vector< RTYPE >::get_na();
+      }
+      }
+    }
+    return v;
+  }
+
+  // numbers and bools in a character vector are converted with as.character(),
+  // like list_to_vector< STRSXP >(), but all at once
+  inline SEXP string_vector( const record_cell* cells, R_xlen_t n ) {
+    R_xlen_t i;
+    std::vector< R_xlen_t > int_rows;
+    std::vector< R_xlen_t > double_rows;
+    Rcpp::StringVector v( n );
+    jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
+
+    for( i = 0; i < n; ++i ) {
+      const record_cell& c = cells[ i ];
+      switch( c.kind ) {
+      case CELL_STRING: {
+        SET_STRING_ELT( v, i, Rf_mkCharCE( c.s, CE_UTF8 ) );
+        break;
+      }
+      case CELL_BOOL: {
+        SET_STRING_ELT( v, i, Rf_mkChar( c.i ? "TRUE" : "FALSE" ) );
+        break;
+      }
+      case CELL_INT: {
+        int_rows.push_back( i );
+        break;
+      }
+      case CELL_DOUBLE: {
+        double_rows.push_back( i );
+        break;
+      }
+      default: {
+        SET_STRING_ELT( v, i, NA_STRING );
+      }
+      }
+    }
+
+    if( !int_rows.empty() ) {
+      Rcpp::IntegerVector ints( int_rows.size() );
+      for( i = 0; i < ints.size(); ++i ) {
+        ints[ i ] = cells[ int_rows[ i ] ].i;
+      }
+      Rcpp::StringVector strs = Rcpp::as< Rcpp::StringVector >( ints );
+      for( i = 0; i < strs.size(); ++i ) {
+        SET_STRING_ELT( v, int_rows[ i ], STRING_ELT( strs, i ) );
+      }
+    }
+    if( !double_rows.empty() ) {
+      Rcpp::NumericVector dbls( double_rows.size() );
+      for( i = 0; i < dbls.size(); ++i ) {
+        dbls[ i ] = cells[ double_rows[ i ] ].d;
+      }
+      Rcpp::StringVector strs = Rcpp::as< Rcpp::StringVector >( dbls );
+      for( i = 0; i < strs.size(); ++i ) {
+        SET_STRING_ELT( v, double_rows[ i ], STRING_ELT( strs, i ) );
+      }
+    }
+    return v;
+  }
+
+  // scalars (no arrays or objects), as the vector of 'r_type' they simplify to
+  inline SEXP scalar_vector( const record_cell* cells, R_xlen_t n, int r_type ) {
+    switch( r_type ) {
+    case INTSXP: {
+      return scalar_vector< INTSXP >( cells, n );
+    }
+    case REALSXP: {
+      return scalar_vector< REALSXP >( cells, n );
+    }
+    case STRSXP: {
+      return string_vector( cells, n );
+    }
+    default: {
+      return scalar_vector< LGLSXP >( cells, n );
+    }
+    }
+  }
+
+  // a column with arrays or objects is made a list of the cells, with the
+  // type, struct_type (1 vector, 2 matrix, 3 list) and length tracked through the
+  // rows as simplify_dataframe() and simplify_dataframe_fill_na() do, and then
+  // finished in the same way
+  template< typename T >
+  inline SEXP list_column( const std::vector< record_cell >& cells, bool fill_na ) {
+    R_xlen_t n_rows = static_cast< R_xlen_t >( cells.size() );
+    R_xlen_t i;
+    Rcpp::List lst( n_rows );
+    jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
+
+    int r_type = -1;
+    R_xlen_t struct_type = -1;
+    R_xlen_t length = -1;
+
+    for( i = 0; i < n_rows; ++i ) {
+      const record_cell& c = cells[ i ];
+      if( c.kind == CELL_MISSING ) {
+        lst[ i ] = NA_LOGICAL;
+        continue;
+      }
+
+      SEXP this_elem = cell_to_sexp< T >( c, fill_na );
+      lst[ i ] = this_elem;
+
+      R_xlen_t sexp_length = get_sexp_length( this_elem );
+      int this_type = TYPEOF( this_elem );
+      bool is_matrix = Rf_isMatrix( this_elem );
+      bool first = struct_type == -1;
+      R_xlen_t this_struct;
+
+      if( sexp_length > 1 && this_type != VECSXP && !is_matrix ) {
+        this_struct = fill_na ? 3 : 2;
+      } else if( ( this_type == VECSXP && ( fill_na || first ) ) || is_matrix ) {
+        this_struct = 3;
+      } else {
+        this_struct = 1;
+      }
+
+      if( first ) {
+        r_type = this_type;
+        struct_type = this_struct;
+        length = sexp_length;
+        continue;
+      }
+
+      if( ( this_struct != struct_type || sexp_length != length ) || ( r_type != this_type && this_struct == 2 ) ) {
+        struct_type = 3;
+      }
+      if( fill_na && sexp_length > length ) {
+        length = sexp_length;
+      }
+      if( this_type > r_type ) {
+        r_type = this_type;
+      }
+    }
+
+    if( struct_type == 3 ) {
+      // can it be a data.frame?
+      return fill_na ? simplify_dataframe_fill_na( lst, n_rows ) : simplify_dataframe( lst, n_rows );
+    }
+    return column_to_vector( lst, r_type, struct_type );
+  }
+
+  // the columns of a data.frame, added to a record (row) at a time
+  class record_columns {
+  public:
+
+    record_columns() : n_rows_( 0 ), fill_na_( false ) {}
+
+    void reset( bool fill_na ) {
+      columns_.clear();
+      column_index_.clear();
+      row_columns_.clear();
+      row_starts_.clear();
+      n_rows_ = 0;
+      fill_na_ = fill_na;
+    }
+
+    R_xlen_t n_rows() const { return n_rows_; }
+
+    // adds the next record. Returns false if it can't be a row: it's empty, has a
+    // duplicate key, or (without fill_na) doesn't have the keys of the first record.
+    // The rows already added are kept, but no more can be added
+    bool add( const record_key* keys, const record_cell* cells, size_t n ) {
+      size_t n_cols = columns_.size();
+      size_t j;
+
+      if( n == 0 || ( !fill_na_ && n_rows_ > 0 && n != n_cols ) ) {
+        return false;
+      }
+
+      // find the columns first, so nothing is added to them if the record is refused
+      size_t first = row_columns_.size();
+      for( j = 0; j < n; ++j ) {
+        size_t col = find_column( keys[ j ], j );
+        if( col == npos() || columns_[ col ].last_row == n_rows_ ) {
+          // an unknown or duplicate key
+          row_columns_.resize( first );
+          return false;
+        }
+        columns_[ col ].last_row = n_rows_;
+        row_columns_.push_back( col );
+      }
+
+      for( j = 0; j < n; ++j ) {
+        column& b = columns_[ row_columns_[ first + j ] ];
+        const record_cell& c = cells[ j ];
+        if( b.cells.size() < static_cast< size_t >( n_rows_ ) ) {
+          b.cells.resize( n_rows_, missing() );
+        }
+        b.cells.push_back( c );
+        if( c.kind == CELL_VALUE || c.kind == CELL_SEXP ) {
+          b.has_values = true;
+        } else {
+          int r_type = cell_r_type( c.kind );
+          b.r_type = r_type > b.r_type ? r_type : b.r_type;
+        }
+      }
+      row_starts_.push_back( first );
+      ++n_rows_;
+      return true;
+    }
+
+    // the data.frame. 'T' is the document's value type, for CELL_VALUE cells
+    template< typename T >
+    SEXP finish() {
+      size_t n_cols = columns_.size();
+      size_t j;
+      Rcpp::List df( n_cols );
+      Rcpp::StringVector names( n_cols );
+      jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS, 2 );
+      for( j = 0; j < n_cols; ++j ) {
+        column& b = columns_[ j ];
+        b.cells.resize( n_rows_, missing() );
+        if( b.has_values ) {
+          df[ j ] = list_column< T >( b.cells, fill_na_ );
+        } else {
+          df[ j ] = scalar_vector( &b.cells[ 0 ], n_rows_, b.r_type );
+        }
+        SET_STRING_ELT( names, j, Rf_mkCharCE( b.name, CE_UTF8 ) );
+      }
+      df.attr("names") = names;
+      return make_dataframe( df, n_rows_ );
+    }
+
+    // row 'r' as the named list parse_object() would have made it
+    template< typename T >
+    SEXP row( R_xlen_t r ) {
+      size_t first = row_starts_[ r ];
+      size_t last = static_cast< size_t >( r + 1 ) < row_starts_.size() ? row_starts_[ r + 1 ] : row_columns_.size();
+      R_xlen_t n = static_cast< R_xlen_t >( last - first );
+      R_xlen_t i;
+      Rcpp::List out( n );
+      Rcpp::CharacterVector names( n );
+      jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS, 2 );
+      for( i = 0; i < n; ++i ) {
+        const column& b = columns_[ row_columns_[ first + i ] ];
+        out[ i ] = cell_to_sexp< T >( b.cells[ r ], fill_na_ );
+        names[ i ] = std::string( b.name );
+      }
+      out.attr("names") = names;
+      return out;
+    }
+
+  private:
+
+    struct column {
+      const char* name;
+      rapidjson::SizeType name_length;
+      std::vector< record_cell > cells;
+      int r_type;         // the highest R type of the scalar cells
+      bool has_values;    // any arrays or objects
+      R_xlen_t last_row;  // the last row with this key, to find duplicate keys
+    };
+
+    static size_t npos() { return static_cast< size_t >( -1 ); }
+
+    static record_cell missing() {
+      record_cell c;
+      c.kind = CELL_MISSING;
+      c.value = NULL;
+      return c;
+    }
+
+    size_t find_column( const record_key& key, size_t j ) {
+      // the keys are usually in the same order in every record
+      if( j < columns_.size() ) {
+        const column& b = columns_[ j ];
+        if( b.name_length == key.length && std::memcmp( b.name, key.name, key.length ) == 0 ) {
+          return j;
+        }
+      }
+      std::string key_string( key.name, key.length );
+      std::unordered_map< std::string, size_t >::iterator it = column_index_.find( key_string );
+      if( it != column_index_.end() ) {
+        return it->second;
+      }
+      if( !fill_na_ && n_rows_ > 0 ) {
+        return npos();
+      }
+      size_t col = columns_.size();
+      column_index_[ key_string ] = col;
+      columns_.push_back( column() );
+      column& b = columns_.back();
+      b.name = key.name;
+      b.name_length = key.length;
+      b.r_type = LGLSXP;
+      b.has_values = false;
+      b.last_row = -1;
+      return col;
+    }
+
+    std::vector< column > columns_;
+    std::unordered_map< std::string, size_t > column_index_;
+    std::vector< size_t > row_columns_;  // the columns of each row's keys, in order
+    std::vector< size_t > row_starts_;
+    R_xlen_t n_rows_;
+    bool fill_na_;
+  };
+
+  // the record_cell of a scalar, or of an array or object to be parsed later.
+  // Scalars are counted here, arrays and objects when they're parsed
+  template< typename T >
+  inline record_cell value_cell( const T& value, uint64_t* counts ) {
+    record_cell c;
+    switch( value.GetType() ) {
+    case rapidjson::kNullType: {
+      c.kind = CELL_NULL;
+      c.value = NULL;
+      ++counts[ jsonify::stats::COUNT_NULL ];
+      break;
+    }
+    case rapidjson::kFalseType: {}
+    case rapidjson::kTrueType: {
+      c.kind = CELL_BOOL;
+      c.i = value.GetBool() ? 1 : 0;
+      ++counts[ jsonify::stats::COUNT_BOOL ];
+      break;
+    }
+    case rapidjson::kStringType: {
+      c.kind = CELL_STRING;
+      c.s = value.GetString();
+      ++counts[ jsonify::stats::COUNT_STRING ];
+      break;
+    }
+    case rapidjson::kNumberType: {
+      if( value.IsDouble() ) {
+        c.kind = CELL_DOUBLE;
+        c.d = value.GetDouble();
+        ++counts[ jsonify::stats::COUNT_DOUBLE ];
+      } else {
+        c.kind = CELL_INT;
+        c.i = value.GetInt();
+        ++counts[ jsonify::stats::COUNT_INT ];
+      }
+      break;
+    }
+    default: {
+      c.kind = CELL_VALUE;
+      c.value = &value;
+    }
+    }
+    return c;
+  }
+
+  // 'json' is an array of objects (and nothing else)
+  template< typename T >
+  inline SEXP records_to_dataframe(
+      const T& json,
+      std::unordered_set< int >& dtypes,
+      bool fill_na
+  ) {
+
+    typedef typename T::ValueType value_type;
+
+    R_xlen_t n_rows = json.Size();
+    size_t j;
+    record_columns columns;
+    std::vector< record_key > keys;
+    std::vector< record_cell > cells;
+    uint64_t counts[ jsonify::stats::N_COUNTERS ] = { 0 };
+    bool simplified = true;
+
+    jsonify::stats::timer t( jsonify::stats::STAGE_SIMPLIFY_DATAFRAME );
+
+    columns.reset( fill_na );
+    for( const auto& record : json.GetArray() ) {
+      ++counts[ jsonify::stats::COUNT_OBJECT ];
+      keys.clear();
+      cells.clear();
+      for( const auto& member : record.GetObject() ) {
+        record_key k;
+        k.name = member.name.GetString();
+        k.length = member.name.GetStringLength();
+        keys.push_back( k );
+        cells.push_back( value_cell( member.value, counts ) );
+      }
+      if( !columns.add( keys.data(), cells.data(), cells.size() ) ) {
+        simplified = false;
+        break;
+      }
+    }
+
+    if( !simplified ) {
+      Rcpp::List arr = parse_array( json, true, fill_na );
+      return simplify( arr, dtypes, n_rows, fill_na );
+    }
+
+    // the values are counted once they won't be parsed again
+    for( j = 0; j < jsonify::stats::N_COUNTERS; ++j ) {
+      if( counts[ j ] > 0 ) {
+        jsonify::stats::count( static_cast< jsonify::stats::counter >( j ), counts[ j ] );
+      }
+    }
+    return columns.finish< value_type >();
+  }
+
+} // namespace from_json
+} // namespace jsonify
+
+#endif
@@ -2,6 +2,7 @@
 #define R_JSONIFY_FROM_JSON_SIMPLIFY_H
 
 #include "rapidjson/document.h"
+#include "jsonify/stats.hpp"
 
 namespace jsonify {
 namespace from_json {
@@ -27,6 +28,7 @@ namespace from_json {
     }
     
     Rcpp::Vector< RTYPE > v( vec_length );
+    jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
     for( i = 0; i < vec_length; counter++, i+=n ) {
       Rcpp::Vector< RTYPE > this_vec = x[ counter ];
       std::copy( this_vec.begin(), this_vec.end(), v.begin() + i );
@@ -74,6 +76,7 @@ namespace from_json {
   ) {
     // takes an array of scalars (any types) and returns
     // them in an R vector
+    jsonify::stats::timer t( jsonify::stats::STAGE_ARRAY_TO_VECTOR );
     int r_type = 0;
     
     // int first_r_type; // for keeping track if the vector has been coerced when simplified
@@ -82,9 +85,12 @@ namespace from_json {
     R_xlen_t arr_len = array.Size();
     R_xlen_t i = 0;
     Rcpp::List out( arr_len );
+    // the list, and an R vector for each element
+    jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS, arr_len + 1 );
     
     for( const auto& child : array ) {
       
+      jsonify::stats::count_value( child );
       switch( child.GetType() ) {
       
       // bool
@@ -147,6 +153,7 @@ namespace from_json {
     
     R_xlen_t i, j;
     Rcpp::Matrix< RTYPE >mat( n_row, n_col );
+    jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
     
     for( i = 0; i < n_row; ++i ) {
       Rcpp::Vector< RTYPE > this_vec = out[i];
@@ -166,6 +173,7 @@ namespace from_json {
       int& r_type
   ) {
     
+    jsonify::stats::timer t( jsonify::stats::STAGE_SIMPLIFY_MATRIX );
     switch( r_type ) {
     case INTSXP: {
       return simplify_matrix< INTSXP >( out, n_col, n_row ); 
@@ -191,6 +199,7 @@ namespace from_json {
   inline SEXP list_to_matrix(
       Rcpp::List& array_of_array
   ) {
+    jsonify::stats::timer t( jsonify::stats::STAGE_SIMPLIFY_MATRIX );
     R_xlen_t n = array_of_array.size();
     R_xlen_t j;
     std::unordered_set< R_xlen_t > array_lengths;
@@ -224,6 +233,7 @@ namespace from_json {
       
       return jsonify::from_json::simplify_matrix( array_of_array, n_col, n_row, r_type );
     } else {
+      jsonify::stats::count( jsonify::stats::COUNT_SIMPLIFY_FALLBACKS );
       return array_of_array;
     }
   }
@@ -231,16 +241,14 @@ namespace from_json {
   // takes a list element and converts it to the correct type
   // only works with single-elements (vectors)
   template< int RTYPE >
-  inline void list_to_vector(
-      Rcpp::List& lst,
-      Rcpp::List& columns,
-      std::string& this_name,
-      bool fill_na
+  inline SEXP list_to_vector(
+      Rcpp::List& lst
   ) {
     
     R_xlen_t i;
     R_xlen_t n_rows = lst.size();
     Rcpp::Vector< RTYPE > v( n_rows );
+    jsonify::stats::count( jsonify::stats::COUNT_R_VECTORS );
     
     for( i = 0; i < n_rows; ++i ) {
       if( Rf_isNull( lst[i] ) ) {
@@ -250,83 +258,73 @@ namespace from_json {
         v[i] = x[0];
       }
     }
-    columns[ this_name ] = v;
+    return v;
   }
   
-  inline void list_to_vector(
-      Rcpp::List& columns,
-      std::string& this_name,
-      int& r_type,
-      R_xlen_t& struct_type, // 1 vector, 2 matrix, 3 list
-      bool fill_na
+  // a data.frame column, from the list of its cells, their (highest) r_type and 
+  // their struct_type (1 vector, 2 matrix; 3 list is simplified by the caller)
+  inline SEXP column_to_vector(
+      Rcpp::List& lst,
+      int r_type,
+      R_xlen_t struct_type
   ) {
     
-    Rcpp::List lst = columns[ this_name.c_str() ];
     R_xlen_t n_rows = lst.size();
     
-    // TODO; is this needed?
-    if( n_rows > 0 ) {
+    if( n_rows == 0 ) {
+      return lst;
+    }
+    
+    // if struct_type == 2; the result is a matrix
+    // need the dimensions...
+    if( struct_type == 2 ) {
+      // i.e., the entire list element is one matrix.
+      // so n_rows remains
+      // n_cols is the length of the first list element
+      R_xlen_t n_cols = get_sexp_length( lst[0] );
       
-      // if struct_type == 2; the result is a matrix
-      // need the dimensions...
-      if( struct_type == 2 ) {
-        // i.e., the entire list element is one matrix.
-        // so n_rows remains
-        // n_cols is the length of the first list element
-        R_xlen_t n_cols = get_sexp_length( lst[0] );
-        
-        columns[ this_name ] = simplify_matrix( lst, n_cols, n_rows, r_type );
-        
-      } else if( struct_type == 1 ) {
-        
-        switch( r_type ) {
-        case LGLSXP: {
-          list_to_vector< LGLSXP >( lst, columns, this_name, fill_na );
-          break;
-        }
-        case INTSXP: {
-          list_to_vector< INTSXP >( lst, columns, this_name, fill_na );
-          break;
-        }
-        case REALSXP: {
-          list_to_vector< REALSXP >( lst, columns, this_name, fill_na );
-          break;
-        }
-        case STRSXP: {
-          list_to_vector< STRSXP >( lst, columns, this_name, fill_na );
-          break;
-        }
-        case VECSXP: {
-          // TODO ?? (or is it actually correct to not simplify this??)
-          // should it even get here? 
-          //list_to_vector< VECSXP >( lst, columns, this_name, fill_na );
-          //list_to_vector( lst, )
-          break;
-        }
-        case NILSXP: {
-          if( !fill_na ) {
-          // if we are filling with NAs, the column will already exist as NAs
-          // (from append_new_column_fill_na)
-          Rcpp::Nullable< Rcpp::List >lst_null( n_rows );
-          columns[ this_name ] = lst_null;
-        }
-          break;
-        }
-        default: {
-          Rcpp::stop("jsonify - vector-column not found");
-        }
-        }
+      return simplify_matrix( lst, n_cols, n_rows, r_type );
+      
+    } else if( struct_type == 1 ) {
+      
+      switch( r_type ) {
+      case LGLSXP: {
+        return list_to_vector< LGLSXP >( lst );
+      }
+      case INTSXP: {
+        return list_to_vector< INTSXP >( lst );
+      }
+      case REALSXP: {
+        return list_to_vector< REALSXP >( lst );
+      }
+      case STRSXP: {
+        return list_to_vector< STRSXP >( lst );
+      }
+      case VECSXP: {
+        // TODO ?? (or is it actually correct to not simplify this??)
+        // should it even get here? 
+        break;
+      }
+      case NILSXP: {
+        // every cell is NULL, or (with fill_na) NA where the key was missing
+        break;
+      }
+      default: {
+        Rcpp::stop("jsonify - vector-column not found");
+      }
       }
-    } else {
-      // nrows == 0; empty vector/list?
     }
-    
-    // if( struct_type == 3 ) {
-    // // it's a list; can it be simplified to a data.frame?
-    //   
-    // }
-    
-    
+    return lst;
+  }
+  
+  inline void list_to_vector(
+      Rcpp::List& columns,
+      std::string& this_name,
+      int& r_type,
+      R_xlen_t& struct_type // 1 vector, 2 matrix, 3 list
+  ) {
+    Rcpp::List lst = columns[ this_name.c_str() ];
+    columns[ this_name ] = column_to_vector( lst, r_type, struct_type );
   }
   
   inline SEXP make_dataframe(
@@ -347,6 +345,8 @@ namespace from_json {
       R_xlen_t& doc_len
   ) {
     
+    jsonify::stats::timer t( jsonify::stats::STAGE_SIMPLIFY_DATAFRAME );
+    
     // the number of rows is equal to the number of list elements?
     // the number of columns is equal to the unique names
     R_xlen_t n_rows = out.size();
@@ -382,6 +382,7 @@ namespace from_json {
       R_xlen_t list_size = this_list.size();
       
       if( list_names.size() != list_size || list_size == 0 ) {
+        jsonify::stats::count( jsonify::stats::COUNT_SIMPLIFY_FALLBACKS );
         return out;
       }
       
@@ -461,7 +462,7 @@ namespace from_json {
         Rcpp::List lst = columns[ this_name ];
         columns[ this_name ] = simplify_dataframe_fill_na( lst, doc_len );
       } else {
-        list_to_vector( columns, this_name, r_type, struct_type, true );  // true: fill_na
+        list_to_vector( columns, this_name, r_type, struct_type );
       }
     }
     
@@ -476,6 +477,8 @@ namespace from_json {
       R_xlen_t& doc_len
   ) {
     
+    jsonify::stats::timer t( jsonify::stats::STAGE_SIMPLIFY_DATAFRAME );
+    
     // the number of rows is equal to the number of list elements?
     // the number of columns is equal to the unique names
     R_xlen_t n_rows = out.size();
@@ -509,6 +512,7 @@ namespace from_json {
       R_xlen_t list_size = this_list.size();
       
       if( list_names.size() != list_size || list_size == 0 ) {
+        jsonify::stats::count( jsonify::stats::COUNT_SIMPLIFY_FALLBACKS );
         return out;
       }
       
@@ -520,6 +524,7 @@ namespace from_json {
         
         if( found_name == -1 ) {
           // can't simplify
+          jsonify::stats::count( jsonify::stats::COUNT_SIMPLIFY_FALLBACKS );
           return out;
         }
         
@@ -559,6 +564,7 @@ namespace from_json {
         
         if( tp == -1 && i > 0 ) {
           // can't simplify because new column names
+          jsonify::stats::count( jsonify::stats::COUNT_SIMPLIFY_FALLBACKS );
           return out;
         }
         
@@ -592,7 +598,7 @@ namespace from_json {
         Rcpp::List lst = columns[ this_name ];
         columns[ this_name ] = simplify_dataframe( lst, doc_len );
       } else {
-        list_to_vector( columns, this_name, r_type, struct_type, false );  // false : fill_na
+        list_to_vector( columns, this_name, r_type, struct_type );
       }
     }
     
@@ -617,6 +623,7 @@ namespace from_json {
         return jsonify::from_json::simplify_dataframe( out, json_length );
       }
     } else {
+      jsonify::stats::count( jsonify::stats::COUNT_SIMPLIFY_FALLBACKS );
       return out;
     }
     return res;
@@ -0,0 +1,151 @@
+#ifndef R_JSONIFY_FROM_JSON_SOURCES_H
+#define R_JSONIFY_FROM_JSON_SOURCES_H
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#define JSONIFY_NO_MMAP
+#endif
+
+#ifndef JSONIFY_NO_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#endif
+
+#define JSONIFY_READ_BUFFER_SIZE 65536
+
+// JSON sources for rapidjson's ParseInsitu(), which decodes the strings in place
+// and points the document at them, so they're never copied into the document's
+// allocator. The source must be writable, null-terminated, and outlive the document
+
+namespace jsonify {
+namespace sources {
+
+  // a file as a private (copy-on-write) memory mapping. Pages are read as the
+  // parser reaches them, and its writes are never seen by the file. The mapping
+  // is made inside an anonymous one which is at least a byte longer than the file,
+  // so it's always followed by a zero to terminate it. Only regular files with a
+  // size can be mapped; anything else (a fifo, /dev/stdin, a /proc file) is read
+  // into memory until it ends, as every file is without mmap (Windows)
+  class mapped_file {
+  public:
+
+    mapped_file( const char* path, const char* mode = "rb" )
+      : data_( NULL ),
+        size_( 0 ),
+        mapped_( 0 ) {
+#ifdef JSONIFY_NO_MMAP
+      read( path, mode );
+#else
+      map( path, mode );
+#endif
+    }
+
+    ~mapped_file() {
+#ifndef JSONIFY_NO_MMAP
+      if( mapped_ > 0 ) {
+        munmap( data_, mapped_ );
+      }
+#endif
+    }
+
+    bool is_open() const { return data_ != NULL; }
+
+    char* data() { return data_; }
+    size_t size() const { return size_; }
+
+  private:
+    mapped_file( const mapped_file& );
+    mapped_file& operator=( const mapped_file& );
+
+#ifndef JSONIFY_NO_MMAP
+    void map( const char* path, const char* mode ) {
+      int fd = ::open( path, O_RDONLY );
+      if( fd < 0 ) {
+        return;
+      }
+      struct stat st;
+      if( fstat( fd, &st ) != 0 ) {
+        ::close( fd );
+        return;
+      }
+      if( !S_ISREG( st.st_mode ) || st.st_size <= 0 ) {
+        // read from the descriptor that's open; a fifo's writer may only write once
+        FILE* fp = fdopen( fd, mode );
+        if( fp == NULL ) {
+          ::close( fd );
+          return;
+        }
+        read( fp );
+        return;
+      }
+      size_t size = static_cast< size_t >( st.st_size );
+      size_t page = static_cast< size_t >( sysconf( _SC_PAGESIZE ) );
+      size_t mapped = ( size / page + 1 ) * page;
+
+      void* region = mmap( NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+      if( region == MAP_FAILED ) {
+        ::close( fd );
+        return;
+      }
+      if( size > 0 && mmap( region, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0 ) == MAP_FAILED ) {
+        munmap( region, mapped );
+        ::close( fd );
+        return;
+      }
+      // the mapping holds its own reference to the file
+      ::close( fd );
+
+#ifdef MADV_SEQUENTIAL
+      if( size > 0 ) {
+        madvise( region, size, MADV_SEQUENTIAL );
+      }
+#endif
+      data_ = static_cast< char* >( region );
+      size_ = size;
+      mapped_ = mapped;
+    }
+#endif
+
+    void read( const char* path, const char* mode ) {
+      FILE* fp = std::fopen( path, mode );
+      if( fp == NULL ) {
+        return;
+      }
+      read( fp );
+    }
+
+    // reads (and closes) 'fp' to the end, however long it turns out to be
+    void read( FILE* fp ) {
+      size_t n;
+      do {
+        size_t at = buffer_.size();
+        buffer_.resize( at + JSONIFY_READ_BUFFER_SIZE );
+        n = std::fread( &buffer_[ at ], 1, JSONIFY_READ_BUFFER_SIZE, fp );
+        buffer_.resize( at + n );
+      } while( n == JSONIFY_READ_BUFFER_SIZE );
+      std::fclose( fp );
+
+      size_ = buffer_.size();
+      buffer_.push_back( '\0' );
+      data_ = &buffer_[ 0 ];
+    }
+
+    char* data_;
+    size_t size_;
+    size_t mapped_;
+    std::vector< char > buffer_;
+  };
+
+} // namespace sources
+} // namespace jsonify
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef R_JSONIFY_STATS_H
+#define R_JSONIFY_STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "rapidjson/document.h"
+
+// Opt-in instrumentation: per-stage timers and counters for from_json() and
+// to_json(), switched on from R with jsonify_stats_enable().
+//
+// Every probe first tests enabled(), a relaxed load of one flag, so when
+// instrumentation is off a probe is a single (well-predicted) branch. Compiling
+// with -DJSONIFY_NO_STATS makes enabled() a constant false, and the probes are
+// removed entirely.
+//
+// Timers are inclusive, and only the outermost call of a recursive stage is
+// timed. Counters and timers are atomic, because the rows of a data.frame
+// can be written on several threads; time spent on several threads is summed.
+
+namespace jsonify {
+namespace stats {
+
+  enum stage {
+    STAGE_PARSE = 0,          // rapidjson's Document::Parse()
+    STAGE_GET_DTYPES,
+    STAGE_ARRAY_TO_VECTOR,
+    STAGE_SIMPLIFY_DATAFRAME,
+    STAGE_SIMPLIFY_MATRIX,
+    STAGE_WRITE_VALUE,        // complex::write_value()
+    N_STAGES
+  };
+
+  enum counter {
+    COUNT_BYTES_PARSED = 0,
+    COUNT_BYTES_WRITTEN,
+    COUNT_NULL,
+    COUNT_BOOL,
+    COUNT_INT,
+    COUNT_DOUBLE,
+    COUNT_STRING,
+    COUNT_ARRAY,
+    COUNT_OBJECT,
+    COUNT_R_VECTORS,          // R vectors allocated while parsing
+    COUNT_SIMPLIFY_FALLBACKS, // arrays left as lists because they couldn't be simplified
+    N_COUNTERS
+  };
+
+  inline const char* stage_name( int s ) {
+    static const char* names[ N_STAGES ] = {
+      "parse", "get_dtypes", "array_to_vector", "simplify_dataframe",
+      "simplify_matrix", "write_value"
+    };
+    return names[ s ];
+  }
+
+  inline const char* counter_name( int c ) {
+    static const char* names[ N_COUNTERS ] = {
+      "bytes_parsed", "bytes_written", "null", "bool", "int", "double",
+      "string", "array", "object", "r_vectors", "simplify_fallbacks"
+    };
+    return names[ c ];
+  }
+
+  struct state {
+    std::atomic< bool > enabled;
+    std::atomic< uint64_t > ns[ N_STAGES ];
+    std::atomic< uint64_t > calls[ N_STAGES ];
+    std::atomic< uint64_t > counts[ N_COUNTERS ];
+  };
+
+  inline state& get_state() {
+    // zero-initialised (static storage)
+    static state s;
+    return s;
+  }
+
+  inline bool enabled() {
+#ifdef JSONIFY_NO_STATS
+    return false;
+#else
+    return get_state().enabled.load( std::memory_order_relaxed );
+#endif
+  }
+
+  // returns the previous setting
+  inline bool set_enabled( bool enable ) {
+#ifdef JSONIFY_NO_STATS
+    (void)enable;
+    return false;
+#else
+    return get_state().enabled.exchange( enable );
+#endif
+  }
+
+  inline int& depth( stage s );
+
+  // also clears this thread's nesting, in case an R error jumped over a timer
+  inline void reset() {
+    state& s = get_state();
+    int i;
+    for( i = 0; i < N_STAGES; ++i ) {
+      s.ns[ i ] = 0;
+      s.calls[ i ] = 0;
+      depth( static_cast< stage >( i ) ) = 0;
+    }
+    for( i = 0; i < N_COUNTERS; ++i ) {
+      s.counts[ i ] = 0;
+    }
+  }
+
+  inline void count( counter c, uint64_t n = 1 ) {
+    if( enabled() ) {
+      get_state().counts[ c ].fetch_add( n, std::memory_order_relaxed );
+    }
+  }
+
+  // the JSON type of a rapidjson value, as a counter
+  template< typename T >
+  inline void count_value( const T& value ) {
+    if( !enabled() ) {
+      return;
+    }
+    counter c;
+    switch( value.GetType() ) {
+    case rapidjson::kNullType: c = COUNT_NULL; break;
+    case rapidjson::kFalseType: {}
+    case rapidjson::kTrueType: c = COUNT_BOOL; break;
+    case rapidjson::kObjectType: c = COUNT_OBJECT; break;
+    case rapidjson::kArrayType: c = COUNT_ARRAY; break;
+    case rapidjson::kStringType: c = COUNT_STRING; break;
+    default: c = value.IsDouble() ? COUNT_DOUBLE : COUNT_INT;
+    }
+    count( c );
+  }
+
+  // the nesting of each stage on this thread, so recursive stages are timed once
+  inline int& depth( stage s ) {
+    static thread_local int d[ N_STAGES ] = { 0 };
+    return d[ s ];
+  }
+
+  // times its scope, if instrumentation was enabled when it was made
+  class timer {
+  public:
+    explicit timer( stage s ) : stage_( s ), counted_( enabled() ), active_( false ) {
+      if( counted_ && depth( s )++ == 0 ) {
+        active_ = true;
+        start_ = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~timer() {
+      if( !counted_ ) {
+        return;
+      }
+      if( active_ ) {
+        std::chrono::steady_clock::duration d = std::chrono::steady_clock::now() - start_;
+        state& s = get_state();
+        s.ns[ stage_ ].fetch_add(
+          static_cast< uint64_t >( std::chrono::duration_cast< std::chrono::nanoseconds >( d ).count() ),
+          std::memory_order_relaxed
+        );
+        s.calls[ stage_ ].fetch_add( 1, std::memory_order_relaxed );
+      }
+      --depth( stage_ );
+    }
+
+  private:
+    timer( const timer& );
+    timer& operator=( const timer& );
+
+    stage stage_;
+    bool counted_;
+    bool active_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+} // namespace stats
+} // namespace jsonify
+
+#endif
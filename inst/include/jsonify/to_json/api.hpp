@@ -3,44 +3,190 @@
 
 #include <Rcpp.h>
 #include "jsonify/to_json/utils.hpp"
+#include "jsonify/to_json/writers/json_writer.hpp"
 #include "jsonify/to_json/writers/complex.hpp"
+#include "jsonify/to_json/writers/parallel.hpp"
 
 namespace jsonify {
 namespace api {
 
+  // The options of each call are resolved into a jsonify::writers::policy here,
+  // once, by dispatch(), and everything is written with it from there down
+
+  template< typename OutputStream >
+  struct json_document {
+    OutputStream& os;
+    SEXP lst;
+    int threads;
+    const jsonify::writers::complex::write_options& opts;
+    
+    template< typename Policy >
+    void operator()( Policy ) {
+      // data.frames and matrices can be written by-row on several threads
+      if( threads > 1 && jsonify::writers::parallel::write_value< Policy >( os, lst, threads, opts ) ) {
+        return;
+      }
+      
+      jsonify::writers::json_writer< OutputStream > writer( os, opts.validate_json );
+      jsonify::writers::complex::write_value< Policy >( writer, lst, opts );
+    }
+  };
+
+  template< typename OutputStream >
+  inline void write_json(
+    OutputStream& os,
+    SEXP lst, 
+    bool unbox = false, 
+    int digits = -1, 
+    bool numeric_dates = true, 
+    bool factors_as_string = true, 
+    const std::string& by = "row",
+    int threads = 1,
+    bool validate_json = false,
+    const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+  ) {
+    jsonify::writers::complex::write_options opts = { digits, datetime, validate_json };
+    json_document< OutputStream > doc = { os, lst, threads, opts };
+    jsonify::writers::policy::dispatch( unbox, digits, numeric_dates, factors_as_string, jsonify::writers::policy::by_column( by ), doc );
+  }
+
   inline Rcpp::StringVector to_json(
     SEXP lst, 
     bool unbox = false, 
     int digits = -1, 
     bool numeric_dates = true, 
     bool factors_as_string = true, 
-    std::string by = "row"
+    const std::string& by = "row",
+    int threads = 1,
+    bool validate_json = false,
+    const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
   ) {
     rapidjson::StringBuffer sb;
-    rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-    jsonify::writers::complex::write_value( writer, lst, unbox, digits, numeric_dates, factors_as_string, by );
+    write_json( sb, lst, unbox, digits, numeric_dates, factors_as_string, by, threads, validate_json, datetime );
+    jsonify::stats::count( jsonify::stats::COUNT_BYTES_WRITTEN, sb.GetSize() );
     return jsonify::utils::finalise_json( sb );
   }
+  
+  // writes the JSON straight into a raw vector, so there's never a second copy of
+  // it. It's written twice: once to a counting_stream, which only adds up its
+  // length, and once into the vector. "json" strings are only validated the first
+  // time; the second pass writes exactly what the first one measured
+  inline Rcpp::RawVector to_json_raw(
+    SEXP lst, 
+    bool unbox = false, 
+    int digits = -1, 
+    bool numeric_dates = true, 
+    bool factors_as_string = true, 
+    const std::string& by = "row",
+    int threads = 1,
+    bool validate_json = false,
+    const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+  ) {
+    jsonify::streams::counting_stream cs;
+    write_json( cs, lst, unbox, digits, numeric_dates, factors_as_string, by, threads, validate_json, datetime );
+    
+    size_t n = cs.GetSize();
+    Rcpp::RawVector res( Rf_allocVector( RAWSXP, static_cast< R_xlen_t >( n ) ) );
+    
+    jsonify::streams::buffer_stream bs( reinterpret_cast< char* >( RAW( res ) ), n );
+    write_json( bs, lst, unbox, digits, numeric_dates, factors_as_string, by, threads, false, datetime );
+    
+    if( bs.GetSize() != n ) {
+      Rcpp::stop("jsonify - unexpected JSON length when writing to a raw vector");
+    }
+    jsonify::stats::count( jsonify::stats::COUNT_BYTES_WRITTEN, n );
+    return res;
+  }
+
+  // the JSON as a list of raw vectors, each (but the last) at least 'chunk_size'
+  // bytes and ending at a value boundary, so it's never in one R string
+  inline Rcpp::List to_json_chunks(
+    SEXP lst, 
+    bool unbox = false, 
+    int digits = -1, 
+    bool numeric_dates = true, 
+    bool factors_as_string = true, 
+    const std::string& by = "row",
+    int threads = 1,
+    size_t chunk_size = JSONIFY_CHUNK_SIZE,
+    bool validate_json = false,
+    const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+  ) {
+    jsonify::streams::chunk_stream cs( chunk_size );
+    write_json( cs, lst, unbox, digits, numeric_dates, factors_as_string, by, threads, validate_json, datetime );
+    jsonify::stats::count( jsonify::stats::COUNT_BYTES_WRITTEN, cs.GetSize() );
+    return jsonify::utils::finalise_chunks( cs );
+  }
+
+  template< typename Stream >
+  inline void open_file( Stream& stream, const char* path ) {
+    if( !stream.is_open() ) {
+      Rcpp::stop("jsonify - could not open file %s", path );
+    }
+  }
+  
+  template< typename Stream >
+  inline void close_file( Stream& stream, const char* path ) {
+    jsonify::stats::count( jsonify::stats::COUNT_BYTES_WRITTEN, stream.GetSize() );
+    if( !stream.close() ) {
+      Rcpp::stop("jsonify - could not write to file %s", path );
+    }
+  }
+  
+  inline bool use_gzip( const std::string& compress, int compression_level ) {
+    if( compress == "none" ) {
+      return false;
+    }
+    if( compress != "gzip" ) {
+      Rcpp::stop("jsonify - compress must be one of \"none\" or \"gzip\"");
+    }
+    if( compression_level < 1 || compression_level > 9 ) {
+      Rcpp::stop("jsonify - compression_level must be between 1 and 9");
+    }
+    return true;
+  }
+
+  // streams the JSON to 'path' through a buffer of 'buffer_size' bytes, so the
+  // whole document is never held in memory. With compress = "gzip" the buffer is
+  // gzip-compressed each time it fills
+  inline void to_json_file(
+    SEXP lst, 
+    const char* path,
+    bool unbox = false, 
+    int digits = -1, 
+    bool numeric_dates = true, 
+    bool factors_as_string = true, 
+    const std::string& by = "row",
+    int threads = 1,
+    size_t buffer_size = JSONIFY_FILE_BUFFER_SIZE,
+    const std::string& compress = "none",
+    int compression_level = JSONIFY_GZIP_LEVEL,
+    bool validate_json = false,
+    const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+  ) {
+    if( use_gzip( compress, compression_level ) ) {
+      jsonify::streams::gzip_stream gz( path, compression_level, buffer_size );
+      open_file( gz, path );
+      write_json( gz, lst, unbox, digits, numeric_dates, factors_as_string, by, threads, validate_json, datetime );
+      close_file( gz, path );
+      return;
+    }
+    jsonify::streams::file_stream fs( path, buffer_size );
+    open_file( fs, path );
+    write_json( fs, lst, unbox, digits, numeric_dates, factors_as_string, by, threads, validate_json, datetime );
+    close_file( fs, path );
+  }
 
-  // inline Rcpp::StringVector to_ndjson(
-  //   Rcpp::DataFrame& df,
-  //   bool unbox = false,
-  //   int digits = -1,
-  //   bool numeric_dates = true,
-  //   bool factors_as_string = true,
-  //   std::string by = "row"
-  // ) {
-  //   // loop over rows or columns, 
-  // }
+  // Each line of ndjson is a separate JSON document. They're all written to the
+  // same stream by the same writer, which is Reset() for each line, so nothing
+  // is allocated per line; the stream decides whether the lines are kept in
+  // memory or flushed to a file
   
+  template< typename Policy, typename OutputStream >
   inline void to_ndjson(
       Rcpp::DataFrame& df,
-      std::ostringstream& os,
-      bool unbox = false,
-      int digits = -1,
-      bool numeric_dates = true,
-      bool factors_as_string = true,
-      std::string by = "row"
+      OutputStream& os,
+      const jsonify::writers::complex::write_options& opts
   ) {
     R_xlen_t n_row = df.nrow();
     R_xlen_t n_cols = df.ncol();
@@ -49,275 +195,67 @@ namespace api {
     Rcpp::StringVector column_names = df.names();
     bool in_data_frame = true;
     
-    //std::ostringstream os; // for storing the final string of ndjson
+    jsonify::writers::json_writer< OutputStream > writer( os, opts.validate_json );
     
-    if( by == "row" ) {
+    if( !Policy::by_column ) {
+      
+      std::vector< jsonify::writers::complex::column_plan > plan;
+      jsonify::writers::complex::make_column_plan< Policy >( df, opts.datetime, plan );
       
       for( row = 0; row < n_row; ++row ) {
-        
-        // create new stream each row
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-        
-        writer.StartObject();
-        for( df_col = 0; df_col < n_cols; ++df_col ) {
-          
-          const char *h = column_names[ df_col ];
-          writer.String( h );
-          
-          SEXP this_vec = df[ h ];
-          
-          switch( TYPEOF( this_vec ) ) {
-          
-          case VECSXP: {
-            Rcpp::List lst = Rcpp::as< Rcpp::List >( this_vec );
-            jsonify::writers::complex::write_value(
-              writer, lst, unbox, digits, numeric_dates, factors_as_string, by, row, in_data_frame
-              );
-            break;
-          }
-          default: {
-            jsonify::writers::complex::switch_vector(
-              writer, this_vec, unbox, digits, numeric_dates, factors_as_string, row
-            );
-          }
-          } // end switch
-          
-        } // end for
-        writer.EndObject();
-        
-        os << sb.GetString();
-        os << '\n';
-      }  // end for (row)
+        writer.Reset( os );
+        jsonify::writers::complex::write_row< Policy >( writer, plan, row, opts );
+        os.Put( '\n' );
+      }
       
     } else {
       // by == "column"
       for( df_col = 0; df_col < n_cols; ++df_col ) {
-        // create new stream each row
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
         
+        writer.Reset( os );
         writer.StartObject();
         
         const char *h = column_names[ df_col ];
         writer.String( h );
         SEXP this_vec = df[ h ];
-        jsonify::writers::complex::write_value( writer, this_vec, unbox, digits, numeric_dates, factors_as_string, by, -1, in_data_frame );
+        jsonify::writers::complex::write_value< Policy >( writer, this_vec, opts, -1, in_data_frame );
         
         writer.EndObject();
-        
-        os << sb.GetString();
-        os << '\n';
+        os.Put( '\n' );
       }  // end for (column)
       
     }
-    
-    // Rcpp::StringVector sv = os.str();
-    // return sv;
-  }
-
-  inline void to_ndjson(
-      Rcpp::LogicalMatrix& mat,
-      std::ostringstream& os,
-      bool unbox = false,
-      std::string by = "row"
-  ) {
-    
-    R_xlen_t n_row = mat.nrow();
-    R_xlen_t n_col = mat.ncol();
-    R_xlen_t i;
-    
-    //std::ostringstream os; // for storing the final string of ndjson
-    
-    if( by == "row" ) {
-      
-      for( i = 0; i < n_row; ++i ) {
-        // create new stream each row
-        Rcpp::LogicalVector v = mat( i, Rcpp::_ );
-        
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-        jsonify::writers::simple::write_value( writer, v, unbox );
-        
-        os << sb.GetString();
-        os << '\n';
-      }
-      
-    } else if ( by == "column" ) {
-      
-      for( i = 0; i < n_col; ++i ) {
-        
-        Rcpp::LogicalVector v = mat( Rcpp::_, i );
-        
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-        jsonify::writers::simple::write_value( writer, v, unbox );
-        
-        os << sb.GetString();
-        os << '\n';
-      }
-      
-    } else {
-      Rcpp::stop("jsonify - expecting matrix operatinos by row or column");
-    }
-    // Rcpp::StringVector sv = os.str();
-    // return sv;
   }
 
-  inline void to_ndjson(
-      Rcpp::IntegerMatrix& mat,
-      std::ostringstream& os,
-      bool unbox = false,
-      std::string by = "row"
-  ) {
-    
-    R_xlen_t n_row = mat.nrow();
-    R_xlen_t n_col = mat.ncol();
-    R_xlen_t i;
-    
-    //std::ostringstream os; // for storing the final string of ndjson
-    
-    if( by == "row" ) {
-      
-      for( i = 0; i < n_row; ++i ) {
-        // create new stream each row
-        Rcpp::IntegerVector v = mat( i, Rcpp::_ );
-        
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-        jsonify::writers::simple::write_value( writer, v, unbox );
-        
-        os << sb.GetString();
-        os << '\n';
-      }
-      
-    } else if ( by == "column" ) {
-      
-      for( i = 0; i < n_col; ++i ) {
-        
-        Rcpp::IntegerVector v = mat( Rcpp::_, i );
-        
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-        jsonify::writers::simple::write_value( writer, v, unbox );
-        
-        os << sb.GetString();
-        os << '\n';
-      }
-      
-    } else {
-      Rcpp::stop("jsonify - expecting matrix operatinos by row or column");
-    }
-    // Rcpp::StringVector sv = os.str();
-    // return sv;
-  }
-  
-  
-  inline void to_ndjson(
-    Rcpp::NumericMatrix& mat,
-    std::ostringstream& os,
-    bool unbox = false,
-    int digits = -1,
-    std::string by = "row"
+  // each row (or column) of a logical, integer, numeric or character matrix
+  template< typename Policy, typename OutputStream >
+  inline void to_ndjson_matrix(
+      SEXP mat,
+      OutputStream& os,
+      int digits
   ) {
     
-    R_xlen_t n_row = mat.nrow();
-    R_xlen_t n_col = mat.ncol();
+    R_xlen_t n = Policy::by_column ? Rf_ncols( mat ) : Rf_nrows( mat );
     R_xlen_t i;
     
-    //std::ostringstream os; // for storing the final string of ndjson
+    jsonify::writers::json_writer< OutputStream > writer( os );
     
-    if( by == "row" ) {
-      
-      for( i = 0; i < n_row; ++i ) {
-        // create new stream each row
-        Rcpp::NumericVector v = mat( i, Rcpp::_ );
-        
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-        jsonify::writers::simple::write_value( writer, v, unbox, digits );
-        
-        os << sb.GetString();
-        os << '\n';
-      }
-      
-    } else if ( by == "column" ) {
-      
-      for( i = 0; i < n_col; ++i ) {
-        
-        Rcpp::NumericVector v = mat( Rcpp::_, i );
-        
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-        jsonify::writers::simple::write_value( writer, v, unbox, digits );
-        
-        os << sb.GetString();
-        os << '\n';
-      }
-      
-    } else {
-      Rcpp::stop("jsonify - expecting matrix operatinos by row or column");
-    }
-    // Rcpp::StringVector sv = os.str();
-    // return sv;
-  }
-
-  inline void to_ndjson(
-      Rcpp::StringMatrix& mat,
-      std::ostringstream& os,
-      bool unbox = false,
-      std::string by = "row"
-  ) {
-    
-    R_xlen_t n_row = mat.nrow();
-    R_xlen_t n_col = mat.ncol();
-    R_xlen_t i;
-    
-    //std::ostringstream os; // for storing the final string of ndjson
-    
-    if( by == "row" ) {
-      
-      for( i = 0; i < n_row; ++i ) {
-        // create new stream each row
-        Rcpp::StringVector v = mat( i, Rcpp::_ );
-        
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-        jsonify::writers::simple::write_value( writer, v, unbox );
-        
-        os << sb.GetString();
-        os << '\n';
-      }
-      
-    } else if ( by == "column" ) {
-      
-      for( i = 0; i < n_col; ++i ) {
-        
-        Rcpp::StringVector v = mat( Rcpp::_, i );
-        
-        rapidjson::StringBuffer sb;
-        rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-        jsonify::writers::simple::write_value( writer, v, unbox );
-        
-        os << sb.GetString();
-        os << '\n';
+    for( i = 0; i < n; ++i ) {
+      writer.Reset( os );
+      if( Policy::by_column ) {
+        jsonify::writers::simple::write_matrix_column( writer, mat, i, Policy::unbox, digits );
+      } else {
+        jsonify::writers::simple::write_matrix_row( writer, mat, i, Policy::unbox, digits );
       }
-      
-    } else {
-      Rcpp::stop("jsonify - expecting matrix operations by row or column");
+      os.Put( '\n' );
     }
-    // Rcpp::StringVector sv = os.str();
-    // return sv;
   }
 
+  template< typename Policy, typename OutputStream >
   inline void to_ndjson(
       Rcpp::List& lst,
-      std::ostringstream& os,
-      bool unbox = false,
-      int digits = -1,
-      bool numeric_dates = true,
-      bool factors_as_string = true,
-      std::string by = "row"
+      OutputStream& os,
+      const jsonify::writers::complex::write_options& opts
   ) {
     R_xlen_t n = lst.size();
     R_xlen_t i;
@@ -328,101 +266,47 @@ namespace api {
       list_names = lst.names();
     }
     
+    jsonify::writers::json_writer< OutputStream > writer( os, opts.validate_json );
+    
     for( i = 0; i < n; ++i ) {
-      rapidjson::StringBuffer sb;
-      rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
       SEXP s = lst[ i ];
       
+      writer.Reset( os );
       if( has_names ) {
         writer.StartObject();
         const char *h = list_names[ i ];
         writer.String( h );
       }
-      jsonify::writers::complex::write_value( writer, s, unbox, digits, numeric_dates, factors_as_string, by );
+      jsonify::writers::complex::write_value< Policy >( writer, s, opts );
       if( has_names ) {
         writer.EndObject();
       }
-      os << sb.GetString();
-      os << '\n';
+      os.Put( '\n' );
     }
     
   }
 
-  template < int RTYPE >
-  inline void to_ndjson(
-      Rcpp::Vector< RTYPE > obj,
-      std::ostringstream& os,
-      bool unbox = false,
-      int digits = -1,
-      bool numeric_dates = true,
-      bool factors_as_string = true
-      ) {
-    
-    rapidjson::StringBuffer sb;
-    rapidjson::Writer < rapidjson::StringBuffer > writer( sb );
-    jsonify::writers::simple::write_value( writer, obj, unbox, digits, numeric_dates, factors_as_string );
-    os << sb.GetString();
-    os << '\n';
-    
-  }
-
+  // writes each line followed by '\n'
   // lists are non-recursive; only the first element is ndjsonified...
-  inline Rcpp::StringVector to_ndjson(
-    SEXP& obj,
-    bool unbox = false,
-    int digits = -1,
-    bool numeric_dates = true,
-    bool factors_as_string = true,
-    std::string by = "row"
+  template< typename Policy, typename OutputStream >
+  inline void write_lines(
+    OutputStream& os,
+    SEXP obj,
+    const jsonify::writers::complex::write_options& opts
   ) {
-
-    std::ostringstream os; // for storing the final string of ndjson
     
     switch( TYPEOF( obj ) ) {
-    case LGLSXP: {
-      if( !Rf_isMatrix( obj ) ) {
-
-        to_ndjson< LGLSXP >( obj, os, unbox, digits, numeric_dates, factors_as_string );
-          
-      } else {
-        Rcpp::LogicalMatrix lm = Rcpp::as< Rcpp::LogicalMatrix >( obj );
-        to_ndjson( lm, os, unbox, by );
-      }
-      break;
-    }
-    case INTSXP: {
-      if( !Rf_isMatrix( obj ) ) {
-      
-        to_ndjson< INTSXP >( obj, os, unbox, digits, numeric_dates, factors_as_string );
-        
-      } else {
-        Rcpp::IntegerMatrix im = Rcpp::as< Rcpp::IntegerMatrix >( obj );
-        to_ndjson( im, os, unbox, by );
-
-      }
-      break;
-    }
-    case REALSXP: {
-      if( !Rf_isMatrix( obj ) ) {
-      
-        to_ndjson< REALSXP >( obj, os, unbox, digits, numeric_dates, factors_as_string );
-        
-      } else {
-        Rcpp::NumericMatrix nm = Rcpp::as< Rcpp::NumericMatrix >( obj );
-        to_ndjson( nm, os, unbox, digits, by );
-        
-      }
-      break;
-    }
+    case LGLSXP: {}
+    case INTSXP: {}
+    case REALSXP: {}
     case STRSXP: {
       if( !Rf_isMatrix( obj ) ) {
-        
-        to_ndjson< STRSXP >( obj, os, unbox, digits, numeric_dates, factors_as_string );
-        
+        // a vector is a single line
+        jsonify::writers::json_writer< OutputStream > writer( os, opts.validate_json );
+        jsonify::writers::simple::write_value< Policy >( writer, obj, opts.digits, opts.datetime );
+        os.Put( '\n' );
       } else {
-        Rcpp::StringMatrix sm = Rcpp::as< Rcpp::StringMatrix >( obj );
-        to_ndjson( sm, os, unbox, by );
-        
+        to_ndjson_matrix< Policy >( obj, os, opts.digits );
       }
       break;
     }
@@ -430,12 +314,12 @@ namespace api {
       if( Rf_inherits( obj, "data.frame") ) {
       
         Rcpp::DataFrame df = Rcpp::as< Rcpp::DataFrame >( obj );
-        to_ndjson( df, os, unbox, digits, numeric_dates, factors_as_string, by );
+        to_ndjson< Policy >( df, os, opts );
       
       } else {
         // list
         Rcpp::List lst = Rcpp::as< Rcpp::List >( obj );
-        to_ndjson( lst, os, unbox, digits, numeric_dates, factors_as_string, by );
+        to_ndjson< Policy >( lst, os, opts );
 
       }
       break;
@@ -444,15 +328,205 @@ namespace api {
       Rcpp::stop("jsonify - expecting a matrix, data.frame or list");
       }
     }
+  }
+
+  template< typename OutputStream >
+  struct ndjson_lines {
+    OutputStream& os;
+    SEXP obj;
+    const jsonify::writers::complex::write_options& opts;
     
-    // is this copy expensive?
-    std::string res = os.str();
-    res.pop_back(); // remove final \n
-    Rcpp::StringVector js = res.c_str();
+    template< typename Policy >
+    void operator()( Policy ) {
+      write_lines< Policy >( os, obj, opts );
+    }
+  };
+
+  template< typename OutputStream >
+  inline void write_ndjson(
+    OutputStream& os,
+    SEXP obj,
+    bool unbox = false,
+    int digits = -1,
+    bool numeric_dates = true,
+    bool factors_as_string = true,
+    const std::string& by = "row",
+    bool validate_json = false,
+    const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+  ) {
+    jsonify::writers::complex::write_options opts = { digits, datetime, validate_json };
+    ndjson_lines< OutputStream > lines = { os, obj, opts };
+    jsonify::writers::policy::dispatch( unbox, digits, numeric_dates, factors_as_string, jsonify::writers::policy::by_column( by ), lines );
+  }
+
+  inline Rcpp::StringVector to_ndjson(
+    SEXP& obj,
+    bool unbox = false,
+    int digits = -1,
+    bool numeric_dates = true,
+    bool factors_as_string = true,
+    const std::string& by = "row",
+    bool validate_json = false,
+    const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+  ) {
+
+    rapidjson::StringBuffer sb;
+    write_ndjson( sb, obj, unbox, digits, numeric_dates, factors_as_string, by, validate_json, datetime );
+    
+    // remove final \n
+    if( sb.GetSize() > 0 ) {
+      sb.Pop( 1 );
+    }
+    jsonify::stats::count( jsonify::stats::COUNT_BYTES_WRITTEN, sb.GetSize() );
+    Rcpp::StringVector js = jsonify::utils::finalise_json( sb );
     js.attr("class") = "ndjson";
     return js;
   }
 
+  // the ndjson as a list of raw vectors, split after the end of a line (or between
+  // values, for lines longer than 'chunk_size'). As with to_ndjson() there's no
+  // '\n' after the last line
+  inline Rcpp::List to_ndjson_chunks(
+    SEXP obj,
+    bool unbox = false,
+    int digits = -1,
+    bool numeric_dates = true,
+    bool factors_as_string = true,
+    const std::string& by = "row",
+    size_t chunk_size = JSONIFY_CHUNK_SIZE,
+    bool validate_json = false,
+    const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+  ) {
+    jsonify::streams::chunk_stream cs( chunk_size, true );
+    write_ndjson( cs, obj, unbox, digits, numeric_dates, factors_as_string, by, validate_json, datetime );
+    cs.Pop( 1 );
+    jsonify::stats::count( jsonify::stats::COUNT_BYTES_WRITTEN, cs.GetSize() );
+    return jsonify::utils::finalise_chunks( cs );
+  }
+
+  // one JSON document per line, as the elements of a character vector rather than
+  // joined by '\n'. The rows of data.frames (by-row) and the rows or columns of
+  // matrices are written on 'threads' threads, straight from the column data
+  template< typename Policy >
+  inline Rcpp::StringVector ndjson_documents(
+    SEXP obj,
+    int threads,
+    const jsonify::writers::complex::write_options& opts
+  ) {
+    
+    int r_type = TYPEOF( obj );
+    
+    if( r_type == VECSXP && Rf_inherits( obj, "data.frame" ) ) {
+      
+      if( !Policy::by_column ) {
+        Rcpp::DataFrame df = Rcpp::as< Rcpp::DataFrame >( obj );
+        std::vector< jsonify::writers::complex::column_plan > plan;
+        jsonify::writers::complex::make_column_plan< Policy >( obj, opts.datetime, plan );
+        
+        for( const auto& c : plan ) {
+          if( !jsonify::writers::parallel::can_write_column( c ) ) {
+            threads = 1;
+          }
+        }
+        if( threads > 1 ) {
+          for( auto& c : plan ) {
+            jsonify::writers::parallel::prepare_strings( c );
+          }
+        }
+        jsonify::writers::complex::row_writer< Policy > rw = { plan, opts };
+        return jsonify::writers::parallel::write_documents( df.nrows(), threads, rw, opts.validate_json );
+      }
+      
+      jsonify::writers::parallel::column_document_writer< Policy > cw = { obj, Rf_getAttrib( obj, R_NamesSymbol ), opts };
+      return jsonify::writers::parallel::write_documents( Rf_xlength( obj ), 1, cw, opts.validate_json );
+    }
+    
+    if( Rf_isMatrix( obj ) && ( r_type == REALSXP || r_type == INTSXP || r_type == LGLSXP || r_type == STRSXP ) ) {
+      
+      jsonify::writers::complex::column_plan mat;
+      jsonify::writers::complex::make_matrix_plan( obj, mat );
+      if( threads > 1 ) {
+        jsonify::writers::parallel::prepare_strings( mat );
+      }
+      
+      jsonify::writers::parallel::matrix_writer< Policy > mw = { mat, opts.digits };
+      return jsonify::writers::parallel::write_documents( Policy::by_column ? mat.n_col : mat.n_row, threads, mw );
+    }
+    
+    if( r_type == VECSXP ) {
+      jsonify::writers::parallel::list_document_writer< Policy > lw = { obj, Rf_getAttrib( obj, R_NamesSymbol ), opts };
+      return jsonify::writers::parallel::write_documents( Rf_xlength( obj ), 1, lw, opts.validate_json );
+    }
+    
+    // a vector is a single line
+    rapidjson::StringBuffer sb;
+    write_lines< Policy >( sb, obj, opts );
+    if( sb.GetSize() > 0 ) {
+      sb.Pop( 1 );
+    }
+    jsonify::stats::count( jsonify::stats::COUNT_BYTES_WRITTEN, sb.GetSize() );
+    return jsonify::utils::finalise_json( sb );
+  }
+
+  struct ndjson_vector {
+    SEXP obj;
+    int threads;
+    const jsonify::writers::complex::write_options& opts;
+    Rcpp::StringVector res;
+    
+    template< typename Policy >
+    void operator()( Policy ) {
+      res = ndjson_documents< Policy >( obj, threads, opts );
+    }
+  };
+
+  inline Rcpp::StringVector to_ndjson_vector(
+    SEXP obj,
+    bool unbox = false,
+    int digits = -1,
+    bool numeric_dates = true,
+    bool factors_as_string = true,
+    const std::string& by = "row",
+    int threads = 1,
+    bool validate_json = false,
+    const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+  ) {
+    jsonify::writers::complex::write_options opts = { digits, datetime, validate_json };
+    ndjson_vector nv = { obj, threads, opts, Rcpp::StringVector() };
+    jsonify::writers::policy::dispatch( unbox, digits, numeric_dates, factors_as_string, jsonify::writers::policy::by_column( by ), nv );
+    return nv.res;
+  }
+
+  // streams the ndjson to 'path' a line at a time, through a buffer of
+  // 'buffer_size' bytes (gzip-compressed with compress = "gzip"). Every line, 
+  // including the last, ends with '\n'
+  inline void to_ndjson_file(
+    SEXP obj,
+    const char* path,
+    bool unbox = false,
+    int digits = -1,
+    bool numeric_dates = true,
+    bool factors_as_string = true,
+    const std::string& by = "row",
+    size_t buffer_size = JSONIFY_FILE_BUFFER_SIZE,
+    const std::string& compress = "none",
+    int compression_level = JSONIFY_GZIP_LEVEL,
+    bool validate_json = false,
+    const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+  ) {
+    if( use_gzip( compress, compression_level ) ) {
+      jsonify::streams::gzip_stream gz( path, compression_level, buffer_size );
+      open_file( gz, path );
+      write_ndjson( gz, obj, unbox, digits, numeric_dates, factors_as_string, by, validate_json, datetime );
+      close_file( gz, path );
+      return;
+    }
+    jsonify::streams::file_stream fs( path, buffer_size );
+    open_file( fs, path );
+    write_ndjson( fs, obj, unbox, digits, numeric_dates, factors_as_string, by, validate_json, datetime );
+    close_file( fs, path );
+  }
+
 
 } // namespace api
 } // namespace jsonify
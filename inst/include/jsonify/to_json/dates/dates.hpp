@@ -2,6 +2,25 @@
 #define JSONIFY_DATES_H
 
 #include <Rcpp.h>
+#include "rapidjson/writer.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Dates and date-times are formatted in UTC with integer arithmetic into a
+// buffer on the stack, and written straight to the writer.
+//
+// Date-times can (opt-in) have fractional seconds, and be written as the local
+// time in their time zone with its UTC offset, "2018-01-01T11:00:00+11:00". The
+// offsets are looked up (by R) for every value of a vector before it's written,
+// as they change within a time zone, e.g. with daylight saving.
+
+// "-yyyyyyyyy-mm-ddThh:mm:ss.ssssss+hh:mm:ss" and then some
+#define JSONIFY_DATE_BUFFER_SIZE 48
+#define JSONIFY_SECONDS_PER_DAY 86400
+#define JSONIFY_DATETIME_MAX_DIGITS 6
 
 namespace jsonify {
 namespace dates {
@@ -17,86 +36,301 @@ namespace dates {
     return false;
   }
 
+  // how date-times are written: with 'digits' (0 to 6) decimal places of seconds,
+  // and whether they're in their time zone, with its UTC offset
+  struct datetime_format {
+    int digits;
+    bool offset;
+
+    explicit datetime_format( int d = 0, bool o = false ) : digits( d ), offset( o ) {}
+  };
+
+  inline datetime_format make_datetime_format( int digits, bool offset ) {
+    if( digits < 0 || digits > JSONIFY_DATETIME_MAX_DIGITS ) {
+      Rcpp::stop("jsonify - datetime_digits must be between 0 and 6");
+    }
+    return datetime_format( digits, offset );
+  }
+
+  inline int64_t floor_div( int64_t x, int64_t y ) {
+    int64_t q = x / y;
+    return ( x % y != 0 && ( ( x < 0 ) != ( y < 0 ) ) ) ? q - 1 : q;
+  }
+
+  // days since 1970-01-01 to year / month / day in the proleptic Gregorian calendar
+  // http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+  inline void civil_from_days( int64_t z, int64_t& y, int& m, int& d ) {
+    z += 719468;
+    const int64_t era = floor_div( z, 146097 );
+    const int64_t doe = z - era * 146097;                                   // [0, 146096]
+    const int64_t yoe = ( doe - doe / 1460 + doe / 36524 - doe / 146096 ) / 365; // [0, 399]
+    const int64_t doy = doe - ( 365 * yoe + yoe / 4 - yoe / 100 );         // [0, 365]
+    const int64_t mp = ( 5 * doy + 2 ) / 153;                              // [0, 11]
+    d = static_cast< int >( doy - ( 153 * mp + 2 ) / 5 + 1 );
+    m = static_cast< int >( mp < 10 ? mp + 3 : mp - 9 );
+    y = yoe + era * 400 + ( m <= 2 );
+  }
+
+  inline char* put_two( char* p, int value ) {
+    *p++ = static_cast< char >( '0' + value / 10 );
+    *p++ = static_cast< char >( '0' + value % 10 );
+    return p;
+  }
+
+  // yyyy-mm-dd, with the year padded to (at least) four digits
+  inline char* put_date( char* p, int64_t days ) {
+    int64_t y;
+    int m;
+    int d;
+    civil_from_days( days, y, m, d );
+
+    if( y < 0 ) {
+      *p++ = '-';
+      y = -y;
+    }
+    char digits[ 20 ];
+    int n = 0;
+    do {
+      digits[ n++ ] = static_cast< char >( '0' + y % 10 );
+      y /= 10;
+    } while( y != 0 );
+    while( n < 4 ) {
+      digits[ n++ ] = '0';
+    }
+    while( n > 0 ) {
+      *p++ = digits[ --n ];
+    }
+
+    *p++ = '-';
+    p = put_two( p, m );
+    *p++ = '-';
+    return put_two( p, d );
+  }
+
+  // 'value' is days since the epoch. Returns the length written
+  inline int format_date( double value, char* buffer ) {
+    // seconds are truncated, then floored to the day (as Rcpp::Date does)
+    int64_t secs = static_cast< int64_t >( value * JSONIFY_SECONDS_PER_DAY );
+    char* end = put_date( buffer, floor_div( secs, JSONIFY_SECONDS_PER_DAY ) );
+    return static_cast< int >( end - buffer );
+  }
+
+  // yyyy-mm-ddThh:mm:ss of 'secs' since the epoch
+  inline char* put_datetime( char* p, int64_t secs ) {
+    int64_t days = floor_div( secs, JSONIFY_SECONDS_PER_DAY );
+    int sod = static_cast< int >( secs - days * JSONIFY_SECONDS_PER_DAY );
+
+    p = put_date( p, days );
+    *p++ = 'T';
+    p = put_two( p, sod / 3600 );
+    *p++ = ':';
+    p = put_two( p, ( sod / 60 ) % 60 );
+    *p++ = ':';
+    return put_two( p, sod % 60 );
+  }
+
+  // +hh:mm, with :ss for the (historical) offsets which aren't whole minutes
+  inline char* put_offset( char* p, int offset ) {
+    *p++ = offset < 0 ? '-' : '+';
+    if( offset < 0 ) {
+      offset = -offset;
+    }
+    p = put_two( p, offset / 3600 );
+    *p++ = ':';
+    p = put_two( p, ( offset / 60 ) % 60 );
+    if( offset % 60 != 0 ) {
+      *p++ = ':';
+      p = put_two( p, offset % 60 );
+    }
+    return p;
+  }
+
+  // 'value' is seconds since the epoch, floored to the second. Returns the length written
+  inline int format_datetime( double value, char* buffer ) {
+    char* end = put_datetime( buffer, static_cast< int64_t >( std::floor( value ) ) );
+    return static_cast< int >( end - buffer );
+  }
+
+  // as above, with the seconds truncated to 'fmt.digits' decimal places (of the
+  // value rounded to the microsecond, so 0.3 isn't 0.299). With 'fmt.offset'
+  // it's the local time 'offset' seconds from UTC, followed by the offset, or
+  // (if the offset isn't known, NA_INTEGER) the UTC time followed by "Z"
+  inline int format_datetime( double value, char* buffer, const datetime_format& fmt, int offset ) {
+    double whole = std::floor( value );
+    int64_t secs = static_cast< int64_t >( whole );
+    int64_t fraction = 0;
+    int i;
+
+    if( fmt.digits > 0 ) {
+      fraction = static_cast< int64_t >( std::floor( ( value - whole ) * 1e6 + 0.5 ) );
+      if( fraction >= 1000000 ) {
+        ++secs;
+        fraction = 0;
+      }
+      for( i = fmt.digits; i < JSONIFY_DATETIME_MAX_DIGITS; ++i ) {
+        fraction /= 10;
+      }
+    }
+
+    bool known = fmt.offset && offset != NA_INTEGER;
+    char* p = put_datetime( buffer, known ? secs + offset : secs );
+    if( fmt.digits > 0 ) {
+      *p++ = '.';
+      for( i = fmt.digits - 1; i >= 0; --i ) {
+        p[ i ] = static_cast< char >( '0' + fraction % 10 );
+        fraction /= 10;
+      }
+      p += fmt.digits;
+    }
+    if( known ) {
+      p = put_offset( p, offset );
+    } else if( fmt.offset ) {
+      *p++ = 'Z';
+    }
+    return static_cast< int >( p - buffer );
+  }
+
+  inline bool is_utc( const char* tz ) {
+    return std::strcmp( tz, "UTC" ) == 0 || std::strcmp( tz, "GMT" ) == 0 || 
+      std::strcmp( tz, "Etc/UTC" ) == 0 || std::strcmp( tz, "Etc/GMT" ) == 0;
+  }
+
+  // the UTC offset, in seconds, of each of the date-times 'x' in its time zone (its
+  // "tzone" attribute, or the session's if it hasn't one), from as.POSIXlt()'s 
+  // "gmtoff". NA_INTEGER where it isn't known. Uses R, so is only called on the main thread
+  inline void utc_offsets( SEXP x, std::vector< int >& offsets ) {
+    R_xlen_t n = Rf_xlength( x );
+    SEXP tzone = Rf_getAttrib( x, Rf_install( "tzone" ) );
+
+    if( TYPEOF( tzone ) == STRSXP && Rf_xlength( tzone ) > 0 && is_utc( CHAR( STRING_ELT( tzone, 0 ) ) ) ) {
+      offsets.assign( n, 0 );
+      return;
+    }
+    offsets.assign( n, NA_INTEGER );
+
+    Rcpp::Function as_posixlt( "as.POSIXlt", R_BaseNamespace );
+    Rcpp::List lt = as_posixlt( x );
+    if( !lt.containsElementNamed( "gmtoff" ) ) {
+      return;
+    }
+    Rcpp::IntegerVector gmtoff = Rcpp::as< Rcpp::IntegerVector >( lt[ "gmtoff" ] );
+    if( gmtoff.size() == n ) {
+      std::copy( gmtoff.begin(), gmtoff.end(), offsets.begin() );
+    }
+  }
+
+  // dates which are too far away to format are written as null, as are NAs
+  inline bool can_format( double value, double units_per_day ) {
+    return R_FINITE( value ) && std::fabs( value / units_per_day ) < 1e11;
+  }
+
+  template< typename Writer >
+  inline void write_date( Writer& writer, double value ) {
+    if( !can_format( value, 1 ) ) {
+      writer.Null();
+      return;
+    }
+    char buffer[ JSONIFY_DATE_BUFFER_SIZE ];
+    int n = format_date( value, buffer );
+    writer.String( buffer, static_cast< rapidjson::SizeType >( n ) );
+  }
+
+  template< typename Writer >
+  inline void write_date( Writer& writer, int value ) {
+    if( value == NA_INTEGER ) {
+      writer.Null();
+      return;
+    }
+    write_date( writer, static_cast< double >( value ) );
+  }
+
+  template< typename Writer >
+  inline void write_datetime( Writer& writer, double value ) {
+    if( !can_format( value, JSONIFY_SECONDS_PER_DAY ) ) {
+      writer.Null();
+      return;
+    }
+    char buffer[ JSONIFY_DATE_BUFFER_SIZE ];
+    int n = format_datetime( value, buffer );
+    writer.String( buffer, static_cast< rapidjson::SizeType >( n ) );
+  }
+
+  template< typename Writer >
+  inline void write_datetime( Writer& writer, int value ) {
+    if( value == NA_INTEGER ) {
+      writer.Null();
+      return;
+    }
+    write_datetime( writer, static_cast< double >( value ) );
+  }
+
+  // 'offset' is only used with 'fmt.offset'
+  template< typename Writer >
+  inline void write_datetime( Writer& writer, double value, const datetime_format& fmt, int offset ) {
+    if( !can_format( value, JSONIFY_SECONDS_PER_DAY ) ) {
+      writer.Null();
+      return;
+    }
+    char buffer[ JSONIFY_DATE_BUFFER_SIZE ];
+    int n = format_datetime( value, buffer, fmt, offset );
+    writer.String( buffer, static_cast< rapidjson::SizeType >( n ) );
+  }
+
+  template< typename Writer >
+  inline void write_datetime( Writer& writer, int value, const datetime_format& fmt, int offset ) {
+    if( value == NA_INTEGER ) {
+      writer.Null();
+      return;
+    }
+    write_datetime( writer, static_cast< double >( value ), fmt, offset );
+  }
+
   inline std::string format_date( Rcpp::Date& d ) {
-    int yyyy = d.getYear();
-    int mm = d.getMonth();
-    int dd = d.getDay();
-    std::ostringstream os;
-    os << std::setfill('0') << std::setw(4) << yyyy << "-";
-    os << std::setfill('0') << std::setw(2) << mm << "-";
-    os << std::setfill('0') << std::setw(2) << dd;
-    return os.str();
+    char buffer[ JSONIFY_DATE_BUFFER_SIZE ];
+    int n = format_date( d.getDate(), buffer );
+    return std::string( buffer, n );
   }
 
   inline std::string format_datetime( Rcpp::Datetime& d ) {
-    int yyyy = d.getYear();
-    int mm = d.getMonth();
-    int dd = d.getDay();
-    int h = d.getHours();
-    int m = d.getMinutes();
-    int s = d.getSeconds();
-    std::ostringstream os;
-    //sprintf( res, "%04d-%02d-%02dT%02d:%02d:%02d", yyyy, mm, dd, h, m, s);
-    os << std::setfill('0') << std::setw(4) << yyyy << "-";
-    os << std::setfill('0') << std::setw(2) << mm << "-";
-    os << std::setfill('0') << std::setw(2) << dd << "T";
-    os << std::setfill('0') << std::setw(2) << h << ":";
-    os << std::setfill('0') << std::setw(2) << m << ":";
-    os << std::setfill('0') << std::setw(2) << s;
-    return os.str();
+    char buffer[ JSONIFY_DATE_BUFFER_SIZE ];
+    int n = format_datetime( d.getFractionalTimestamp(), buffer );
+    return std::string( buffer, n );
   }
 
-  inline Rcpp::StringVector date_to_string( Rcpp::IntegerVector& iv ) {
-    
+  template< int RTYPE >
+  inline Rcpp::StringVector dates_to_string( Rcpp::Vector< RTYPE >& v, bool is_datetime ) {
+
     R_xlen_t i;
-    R_xlen_t n = iv.size();
+    R_xlen_t n = v.size();
     Rcpp::StringVector sv( n );
-    
+    char buffer[ JSONIFY_DATE_BUFFER_SIZE ];
+
     for ( i = 0; i < n; ++i ) {
-      Rcpp::Date d = iv[i];
-      sv[i] = format_date( d );
+      double value = Rcpp::Vector< RTYPE >::is_na( v[i] ) ? NA_REAL : static_cast< double >( v[i] );
+      if( !can_format( value, is_datetime ? JSONIFY_SECONDS_PER_DAY : 1 ) ) {
+        sv[i] = NA_STRING;
+      } else {
+        int len = is_datetime ? format_datetime( value, buffer ) : format_date( value, buffer );
+        sv[i] = Rf_mkCharLenCE( buffer, len, CE_UTF8 );
+      }
     }
     return sv;
   }
 
+  inline Rcpp::StringVector date_to_string( Rcpp::IntegerVector& iv ) {
+    return dates_to_string( iv, false );
+  }
+
   inline Rcpp::StringVector date_to_string( Rcpp::NumericVector& nv ) {
-    
-    R_xlen_t i;
-    R_xlen_t n = nv.size();
-    Rcpp::StringVector sv( n );
-    
-    for ( i = 0; i < n; ++i ) {
-      Rcpp::Date d = nv[i];
-      sv[i] = format_date( d );
-    }
-    return sv;
+    return dates_to_string( nv, false );
   }
 
   inline Rcpp::StringVector posixct_to_string( Rcpp::IntegerVector& iv ) {
-    
-    R_xlen_t i;
-    R_xlen_t n = iv.size();
-
-    Rcpp::StringVector sv( n );
-    
-    for( i = 0; i < n; ++i ) {
-      Rcpp::Datetime d = iv[ i ];
-      sv[i] = format_datetime( d );
-    }
-    return sv;
+    return dates_to_string( iv, true );
   }
-  
+
   inline Rcpp::StringVector posixct_to_string( Rcpp::NumericVector nv ) {
-    R_xlen_t i;
-    R_xlen_t n = nv.size();
-    
-    Rcpp::StringVector sv( n );
-    
-    for( i = 0; i < n; ++i ) {
-      Rcpp::Datetime d = nv[ i ];
-      sv[i] = format_datetime( d );
-    }
-    return sv;
+    return dates_to_string( nv, true );
   }
 
 
@@ -104,4 +338,4 @@ namespace dates {
 } // namespace jsonify
 
 
-#endif 
+#endif
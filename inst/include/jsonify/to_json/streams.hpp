@@ -0,0 +1,410 @@
+#ifndef R_JSONIFY_STREAMS_H
+#define R_JSONIFY_STREAMS_H
+
+#include <Rcpp.h>
+
+#include <zlib.h>
+
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#define JSONIFY_FILE_BUFFER_SIZE 65536
+#define JSONIFY_GZIP_LEVEL 6
+#define JSONIFY_CHUNK_SIZE 1048576
+
+// rapidjson output streams which don't keep their own copy of the JSON
+
+namespace jsonify {
+namespace streams {
+
+  // counts the bytes written, used to size the output before writing it. Nothing
+  // is stored, so Put() and Write() are just additions
+  class counting_stream {
+  public:
+    typedef char Ch;
+
+    counting_stream() : size_( 0 ) {}
+
+    void Put( Ch ) { ++size_; }
+    void Write( const Ch*, size_t n ) { size_ += n; }
+    void Flush() {}
+
+    size_t GetSize() const { return size_; }
+
+  private:
+    size_t size_;
+  };
+
+  // writes into a preallocated buffer (e.g. the RAW() of a raw vector) which
+  // must be at least as long as the JSON. Writes past the end are counted, not made
+  class buffer_stream {
+  public:
+    typedef char Ch;
+
+    buffer_stream( char* buffer, size_t capacity ) : buffer_( buffer ), capacity_( capacity ), size_( 0 ) {}
+
+    void Put( Ch c ) {
+      if( size_ < capacity_ ) {
+        buffer_[ size_ ] = c;
+      }
+      ++size_;
+    }
+
+    void Write( const Ch* bytes, size_t n ) {
+      if( size_ + n <= capacity_ ) {
+        std::memcpy( buffer_ + size_, bytes, n );
+      }
+      size_ += n;
+    }
+
+    void Flush() {}
+
+    size_t GetSize() const { return size_; }
+
+  private:
+    char* buffer_;
+    size_t capacity_;
+    size_t size_;
+  };
+
+  // buffered writes to a file. Only 'buffer_size' bytes of JSON are held in memory.
+  // Flush() (called by the writer after each top-level value) is a no-op, so each
+  // ndjson line isn't a separate write; the buffer is written when it's full and by close()
+  class file_stream {
+  public:
+    typedef char Ch;
+
+    file_stream( const char* path, size_t buffer_size = JSONIFY_FILE_BUFFER_SIZE ) 
+      : fp_( std::fopen( path, "wb" ) ), 
+        buffer_( buffer_size > 0 ? buffer_size : 1 ), 
+        n_( 0 ), 
+        written_( 0 ),
+        ok_( true ) {
+      if( fp_ != NULL ) {
+        // this is the buffer
+        std::setvbuf( fp_, NULL, _IONBF, 0 );
+      }
+    }
+
+    ~file_stream() {
+      if( fp_ != NULL ) {
+        std::fclose( fp_ );
+      }
+    }
+
+    bool is_open() const { return fp_ != NULL; }
+
+    void Put( Ch c ) {
+      if( n_ == buffer_.size() ) {
+        write_buffer();
+      }
+      buffer_[ n_++ ] = c;
+    }
+
+    void Write( const Ch* bytes, size_t n ) {
+      if( n > buffer_.size() - n_ ) {
+        write_buffer();
+        if( n >= buffer_.size() ) {
+          write_bytes( bytes, n );
+          return;
+        }
+      }
+      std::memcpy( &buffer_[ n_ ], bytes, n );
+      n_ += n;
+    }
+
+    void Flush() {}
+
+    // the bytes written so far, including those still in the buffer
+    size_t GetSize() const { return written_ + n_; }
+
+    // writes what's left in the buffer and closes the file. Returns false if 
+    // anything failed to write
+    bool close() {
+      if( fp_ == NULL ) {
+        return false;
+      }
+      write_buffer();
+      ok_ = ( std::fclose( fp_ ) == 0 ) && ok_;
+      fp_ = NULL;
+      return ok_;
+    }
+
+  private:
+    file_stream( const file_stream& );
+    file_stream& operator=( const file_stream& );
+
+    void write_bytes( const Ch* bytes, size_t n ) {
+      if( ok_ && n > 0 && std::fwrite( bytes, 1, n, fp_ ) != n ) {
+        ok_ = false;
+      }
+      written_ += n;
+    }
+
+    void write_buffer() {
+      write_bytes( &buffer_[ 0 ], n_ );
+      n_ = 0;
+    }
+
+    FILE* fp_;
+    std::vector< char > buffer_;
+    size_t n_;
+    size_t written_;
+    bool ok_;
+  };
+
+  // gzip-compresses the JSON as it's written to 'path'. The JSON is collected in a
+  // buffer of 'buffer_size' bytes, which is deflated into a second buffer of the 
+  // same size and written out each time it fills, so memory use is bounded by the 
+  // buffers and zlib's own state (about 256KB at the default level)
+  class gzip_stream {
+  public:
+    typedef char Ch;
+
+    gzip_stream( 
+      const char* path, 
+      int level = JSONIFY_GZIP_LEVEL, 
+      size_t buffer_size = JSONIFY_FILE_BUFFER_SIZE 
+    ) 
+      : fp_( std::fopen( path, "wb" ) ), 
+        buffer_( buffer_size > 0 ? buffer_size : 1 ), 
+        out_( buffer_size > 0 ? buffer_size : 1 ),
+        n_( 0 ), 
+        written_( 0 ),
+        ok_( true ),
+        deflating_( false ) {
+      std::memset( &zs_, 0, sizeof( zs_ ) );
+      if( fp_ != NULL ) {
+        std::setvbuf( fp_, NULL, _IONBF, 0 );
+        // 16 + 15 : a gzip header, and the largest window
+        deflating_ = deflateInit2( &zs_, level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY ) == Z_OK;
+        ok_ = deflating_;
+      }
+    }
+
+    ~gzip_stream() {
+      if( deflating_ ) {
+        deflateEnd( &zs_ );
+      }
+      if( fp_ != NULL ) {
+        std::fclose( fp_ );
+      }
+    }
+
+    // false if the file couldn't be opened, or zlib couldn't be initialised
+    bool is_open() const { return fp_ != NULL && ok_; }
+
+    void Put( Ch c ) {
+      if( n_ == buffer_.size() ) {
+        deflate_buffer();
+      }
+      buffer_[ n_++ ] = c;
+    }
+
+    void Write( const Ch* bytes, size_t n ) {
+      if( n > buffer_.size() - n_ ) {
+        deflate_buffer();
+        if( n >= buffer_.size() ) {
+          deflate_bytes( bytes, n, Z_NO_FLUSH );
+          return;
+        }
+      }
+      std::memcpy( &buffer_[ 0 ] + n_, bytes, n );
+      n_ += n;
+    }
+
+    void Flush() {}
+
+    // the (uncompressed) bytes written so far, including those still in the buffer
+    size_t GetSize() const { return written_ + n_; }
+
+    // compresses what's left in the buffer, writes the gzip trailer and closes
+    // the file. Returns false if anything failed to compress or write
+    bool close() {
+      if( fp_ == NULL ) {
+        return false;
+      }
+      if( deflating_ ) {
+        deflate_bytes( &buffer_[ 0 ], n_, Z_FINISH );
+        n_ = 0;
+        deflateEnd( &zs_ );
+        deflating_ = false;
+      }
+      ok_ = ( std::fclose( fp_ ) == 0 ) && ok_;
+      fp_ = NULL;
+      return ok_;
+    }
+
+  private:
+    gzip_stream( const gzip_stream& );
+    gzip_stream& operator=( const gzip_stream& );
+
+    void deflate_bytes( const Ch* bytes, size_t n, int flush ) {
+      written_ += n;
+      if( !ok_ ) {
+        return;
+      }
+      // avail_in is an unsigned int
+      do {
+        size_t chunk = n < static_cast< size_t >( UINT_MAX ) ? n : static_cast< size_t >( UINT_MAX );
+        int chunk_flush = chunk == n ? flush : Z_NO_FLUSH;
+        zs_.next_in = reinterpret_cast< Bytef* >( const_cast< Ch* >( bytes ) );
+        zs_.avail_in = static_cast< uInt >( chunk );
+        do {
+          zs_.next_out = reinterpret_cast< Bytef* >( &out_[ 0 ] );
+          zs_.avail_out = static_cast< uInt >( out_.size() );
+          if( deflate( &zs_, chunk_flush ) == Z_STREAM_ERROR ) {
+            ok_ = false;
+            return;
+          }
+          size_t have = out_.size() - zs_.avail_out;
+          if( have > 0 && std::fwrite( &out_[ 0 ], 1, have, fp_ ) != have ) {
+            ok_ = false;
+            return;
+          }
+        } while( zs_.avail_out == 0 );
+        bytes += chunk;
+        n -= chunk;
+      } while( n > 0 );
+    }
+
+    void deflate_buffer() {
+      deflate_bytes( &buffer_[ 0 ], n_, Z_NO_FLUSH );
+      n_ = 0;
+    }
+
+    FILE* fp_;
+    std::vector< char > buffer_;
+    std::vector< char > out_;
+    size_t n_;
+    size_t written_;
+    bool ok_;
+    bool deflating_;
+    z_stream zs_;
+  };
+
+  // collects the JSON as a sequence of chunks of at least 'chunk_size' bytes, 
+  // each ending at a value boundary: after a ',' or '\n' which isn't inside a 
+  // string. A chunk is only longer than 'chunk_size' by the rest of the value
+  // it was in the middle of, so a single huge value (e.g. a string) is one chunk.
+  // The stream follows the strings as it goes, which is all it needs to know to
+  // find the boundaries of the valid JSON it's given.
+  //
+  // With 'lines' (for ndjson) chunks end at the end of a line, and only end
+  // after a ',' in a line which is itself longer than 'chunk_size'
+  class chunk_stream {
+  public:
+    typedef char Ch;
+
+    explicit chunk_stream( size_t chunk_size = JSONIFY_CHUNK_SIZE, bool lines = false ) 
+      : chunk_size_( chunk_size > 0 ? chunk_size : 1 ),
+        size_( 0 ),
+        line_size_( 0 ),
+        lines_( lines ),
+        in_string_( false ),
+        escaped_( false ) {
+      current_.reserve( chunk_size_ );
+    }
+
+    void Put( Ch c ) {
+      current_.push_back( c );
+      ++size_;
+      if( is_boundary( c ) && current_.size() >= chunk_size_ ) {
+        cut();
+      }
+    }
+
+    void Write( const Ch* bytes, size_t n ) {
+      size_t i;
+      size_t start = 0;
+      for( i = 0; i < n; ++i ) {
+        if( is_boundary( bytes[ i ] ) && current_.size() + ( i + 1 - start ) >= chunk_size_ ) {
+          current_.insert( current_.end(), bytes + start, bytes + i + 1 );
+          start = i + 1;
+          cut();
+        }
+      }
+      current_.insert( current_.end(), bytes + start, bytes + n );
+      size_ += n;
+    }
+
+    void Flush() {}
+
+    // removes the last 'n' bytes (the final '\n' of ndjson)
+    void Pop( size_t n ) {
+      while( n > 0 ) {
+        if( current_.empty() ) {
+          if( chunks_.empty() ) {
+            return;
+          }
+          current_.swap( chunks_.back() );
+          chunks_.pop_back();
+          continue;
+        }
+        current_.pop_back();
+        --size_;
+        --n;
+      }
+    }
+
+    size_t GetSize() const { return size_; }
+
+    // the chunks, including the one being written
+    std::vector< std::vector< char > >& chunks() {
+      if( !current_.empty() ) {
+        cut();
+      }
+      return chunks_;
+    }
+
+  private:
+    chunk_stream( const chunk_stream& );
+    chunk_stream& operator=( const chunk_stream& );
+
+    // follows the strings, and returns true for a ',' or '\n' outside of one
+    // where the chunk can end
+    bool is_boundary( Ch c ) {
+      ++line_size_;
+      if( in_string_ ) {
+        if( escaped_ ) {
+          escaped_ = false;
+        } else if( c == '\\' ) {
+          escaped_ = true;
+        } else if( c == '"' ) {
+          in_string_ = false;
+        }
+        return false;
+      }
+      if( c == '"' ) {
+        in_string_ = true;
+        return false;
+      }
+      if( c == '\n' ) {
+        line_size_ = 0;
+        return true;
+      }
+      return c == ',' && ( !lines_ || line_size_ >= chunk_size_ );
+    }
+
+    void cut() {
+      chunks_.push_back( std::vector< char >() );
+      chunks_.back().swap( current_ );
+      current_.reserve( chunk_size_ );
+    }
+
+    size_t chunk_size_;
+    size_t size_;
+    size_t line_size_;
+    bool lines_;
+    bool in_string_;
+    bool escaped_;
+    std::vector< char > current_;
+    std::vector< std::vector< char > > chunks_;
+  };
+
+} // namespace streams
+} // namespace jsonify
+
+#endif
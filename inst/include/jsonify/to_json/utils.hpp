@@ -6,6 +6,12 @@
 /* // [[Rcpp::depends(rapidjsonr)]] */
 
 #include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+#include "jsonify/to_json/streams.hpp"
+
+#include <cstring>
+#include <climits>
+#include <vector>
 
 namespace jsonify {
 namespace utils {
@@ -30,25 +36,70 @@ namespace utils {
     return "";
   }
   
-  inline void factors_to_string( Rcpp::DataFrame& df ) {
-    R_xlen_t df_col;
-    R_xlen_t n_cols;
-    n_cols = df.ncol();
-    Rcpp::StringVector column_names = df.names();
+  // the CHARSXP is made straight from the buffer; going via Rcpp::String
+  // would strlen() the JSON and hold another copy of it
+  inline Rcpp::StringVector finalise_json( rapidjson::StringBuffer& sb ) {
+    if( sb.GetSize() > static_cast< size_t >( INT_MAX ) ) {
+      Rcpp::stop("jsonify - the JSON is too long for a character vector, use output = \"raw\"");
+    }
+    Rcpp::StringVector js( 1 );
+    SET_STRING_ELT( js, 0, Rf_mkCharLenCE( sb.GetString(), static_cast< int >( sb.GetSize() ), CE_UTF8 ) );
     
-    for( df_col = 0; df_col < n_cols; ++df_col ) {
-      const char * col_name = column_names[ df_col ];
-      if( Rf_isFactor( df[ col_name ] ) ) {
-        df[ col_name ] = Rcpp::as< Rcpp::StringVector >( df[ col_name ] );
+    js.attr("class") = "json";
+    return js;
+  }
+
+  // each chunk becomes a raw vector, and its buffer is freed once it's copied,
+  // so there's only ever one chunk more in memory than the JSON
+  inline Rcpp::List finalise_chunks( jsonify::streams::chunk_stream& cs ) {
+    std::vector< std::vector< char > >& chunks = cs.chunks();
+    R_xlen_t n = static_cast< R_xlen_t >( chunks.size() );
+    R_xlen_t i;
+    Rcpp::List res( n );
+    for( i = 0; i < n; ++i ) {
+      std::vector< char >& chunk = chunks[ i ];
+      SEXP raw = PROTECT( Rf_allocVector( RAWSXP, static_cast< R_xlen_t >( chunk.size() ) ) );
+      if( !chunk.empty() ) {
+        std::memcpy( RAW( raw ), &chunk[ 0 ], chunk.size() );
       }
+      SET_VECTOR_ELT( res, i, raw );
+      UNPROTECT( 1 );
+      std::vector< char >().swap( chunk );
     }
+    return res;
   }
 
-  inline Rcpp::StringVector finalise_json( rapidjson::StringBuffer& sb ) {
-    Rcpp::StringVector js = Rcpp::StringVector::create( Rcpp::String( sb.GetString() ) );
-    
-    js.attr("class") = "json";
-    return js;
+  // appends a block of already-written JSON to an output stream
+  template< typename OutputStream >
+  inline void put_bytes( OutputStream& os, const char* bytes, size_t n ) {
+    size_t i;
+    for( i = 0; i < n; ++i ) {
+      os.Put( bytes[ i ] );
+    }
+  }
+  
+  inline void put_bytes( rapidjson::StringBuffer& os, const char* bytes, size_t n ) {
+    std::memcpy( os.Push( n ), bytes, n );
+  }
+
+  inline void put_bytes( jsonify::streams::counting_stream& os, const char* bytes, size_t n ) {
+    os.Write( bytes, n );
+  }
+
+  inline void put_bytes( jsonify::streams::buffer_stream& os, const char* bytes, size_t n ) {
+    os.Write( bytes, n );
+  }
+
+  inline void put_bytes( jsonify::streams::file_stream& os, const char* bytes, size_t n ) {
+    os.Write( bytes, n );
+  }
+
+  inline void put_bytes( jsonify::streams::gzip_stream& os, const char* bytes, size_t n ) {
+    os.Write( bytes, n );
+  }
+
+  inline void put_bytes( jsonify::streams::chunk_stream& os, const char* bytes, size_t n ) {
+    os.Write( bytes, n );
   }
 
   inline bool should_unbox( int n, bool unbox ) {
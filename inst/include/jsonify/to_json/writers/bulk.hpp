@@ -0,0 +1,245 @@
+#ifndef JSONIFY_WRITERS_BULK_H
+#define JSONIFY_WRITERS_BULK_H
+
+#include <Rcpp.h>
+#include "rapidjson/writer.h"
+#include "jsonify/to_json/writers/numbers.hpp"
+#include "jsonify/to_json/writers/scalars.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Writes whole vectors (or strided slices of matrices) as the elements of an
+// array. The elements are formatted into a block of text, "1,2,null,4", which
+// is handed to the writer in one go, so the writer is called once per block
+// rather than once per element.
+
+#define JSONIFY_BULK_BLOCK_SIZE 4096
+// the longest element, "-2147483647", and its comma
+#define JSONIFY_BULK_MAX_ELEMENT 12
+// the longest double, and its comma
+#define JSONIFY_BULK_MAX_DOUBLE ( JSONIFY_NUMBER_BUFFER_SIZE + 1 )
+
+namespace jsonify {
+namespace writers {
+namespace bulk {
+
+  class block_buffer {
+  public:
+    block_buffer() : n_( 0 ) {}
+
+    template< typename Writer >
+    inline void reserve( Writer& writer, int max_element = JSONIFY_BULK_MAX_ELEMENT ) {
+      if( n_ > JSONIFY_BULK_BLOCK_SIZE - max_element ) {
+        flush( writer );
+      }
+    }
+
+    // the writer adds the comma between blocks
+    template< typename Writer >
+    inline void flush( Writer& writer ) {
+      if( n_ > 0 ) {
+        writer.RawValue( buffer_, n_ - 1, rapidjson::kNumberType );
+        n_ = 0;
+      }
+    }
+
+    inline void put( const char* bytes, int n ) {
+      std::memcpy( buffer_ + n_, bytes, n );
+      n_ += n;
+      buffer_[ n_++ ] = ',';
+    }
+
+    inline void put_int( int value ) {
+      n_ += jsonify::writers::numbers::format_int( value, buffer_ + n_ );
+      buffer_[ n_++ ] = ',';
+    }
+
+    // formats 'value' (which is finite) as scalars::write_number() would, returning
+    // false, having written nothing, if it has to go through the writer
+    template< bool ROUND >
+    inline bool put_double( double value, int digits ) {
+      char* p = buffer_ + n_;
+      int n = ROUND
+        ? jsonify::writers::numbers::format_fixed( value, digits, p )
+        : jsonify::writers::numbers::format_integral( value, p );
+
+      if( n <= 0 ) {
+        if( ROUND ) {
+          double e = jsonify::writers::numbers::power_of_ten( digits );
+          value = round( value * e ) / e;
+          if( !std::isfinite( value ) ) {
+            return false;
+          }
+        }
+        // as Writer::Double()
+        n = static_cast< int >( rapidjson::internal::dtoa( value, p ) - p );
+      }
+      n_ += n;
+      buffer_[ n_++ ] = ',';
+      return true;
+    }
+
+  private:
+    char buffer_[ JSONIFY_BULK_BLOCK_SIZE ];
+    int n_;
+  };
+
+  inline bool any_na( const int* values, R_xlen_t n, R_xlen_t stride ) {
+    R_xlen_t i;
+    R_xlen_t idx;
+    for( i = 0, idx = 0; i < n; ++i, idx += stride ) {
+      if( values[ idx ] == NA_INTEGER ) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // INTSXP values; NA is written as null
+  template< typename Writer >
+  inline void write_integers( Writer& writer, const int* values, R_xlen_t n, R_xlen_t stride = 1 ) {
+
+    R_xlen_t i;
+    R_xlen_t idx;
+    block_buffer block;
+
+    if( !any_na( values, n, stride ) ) {
+      for( i = 0, idx = 0; i < n; ++i, idx += stride ) {
+        block.reserve( writer );
+        block.put_int( values[ idx ] );
+      }
+    } else {
+      for( i = 0, idx = 0; i < n; ++i, idx += stride ) {
+        block.reserve( writer );
+        if( values[ idx ] == NA_INTEGER ) {
+          block.put( "null", 4 );
+        } else {
+          block.put_int( values[ idx ] );
+        }
+      }
+    }
+    block.flush( writer );
+  }
+
+  // LGLSXP values; NA (NA_LOGICAL == NA_INTEGER) is written as null
+  template< typename Writer >
+  inline void write_logicals( Writer& writer, const int* values, R_xlen_t n, R_xlen_t stride = 1 ) {
+
+    R_xlen_t i;
+    R_xlen_t idx;
+    block_buffer block;
+
+    if( !any_na( values, n, stride ) ) {
+      for( i = 0, idx = 0; i < n; ++i, idx += stride ) {
+        block.reserve( writer );
+        if( values[ idx ] != 0 ) {
+          block.put( "true", 4 );
+        } else {
+          block.put( "false", 5 );
+        }
+      }
+    } else {
+      for( i = 0, idx = 0; i < n; ++i, idx += stride ) {
+        block.reserve( writer );
+        if( values[ idx ] == NA_LOGICAL ) {
+          block.put( "null", 4 );
+        } else if( values[ idx ] != 0 ) {
+          block.put( "true", 4 );
+        } else {
+          block.put( "false", 5 );
+        }
+      }
+    }
+    block.flush( writer );
+  }
+
+  // REALSXP values; NA and NaN are written as null. 'ROUND' is digits >= 0
+  template< bool ROUND, typename Writer >
+  inline void write_numbers( Writer& writer, const double* values, R_xlen_t n, R_xlen_t stride, int digits ) {
+
+    R_xlen_t i;
+    R_xlen_t idx;
+    block_buffer block;
+
+    for( i = 0, idx = 0; i < n; ++i, idx += stride ) {
+      double d = values[ idx ];
+      block.reserve( writer, JSONIFY_BULK_MAX_DOUBLE );
+      if( ISNAN( d ) ) {
+        block.put( "null", 4 );
+      } else if( !std::isfinite( d ) || !block.put_double< ROUND >( d, digits ) ) {
+        // infinite values are written as strings
+        block.flush( writer );
+        jsonify::writers::scalars::write_number< ROUND >( writer, d, digits );
+      }
+    }
+    block.flush( writer );
+  }
+
+  template< typename Writer >
+  inline void write_doubles( Writer& writer, const double* values, R_xlen_t n, R_xlen_t stride = 1, int digits = -1 ) {
+    if( digits >= 0 ) {
+      write_numbers< true >( writer, values, n, stride, digits );
+    } else {
+      write_numbers< false >( writer, values, n, stride, digits );
+    }
+  }
+
+  // a STRSXP element, read on the main thread so it can be written on another;
+  // 'chars' is NULL for NA
+  struct string_ref {
+    const char* chars;
+    rapidjson::SizeType length;
+  };
+
+  inline void make_string_refs( SEXP values, std::vector< string_ref >& refs ) {
+    R_xlen_t i;
+    R_xlen_t n = Rf_xlength( values );
+    refs.resize( n );
+    for( i = 0; i < n; ++i ) {
+      SEXP s = STRING_ELT( values, i );
+      refs[ i ].chars = s == NA_STRING ? NULL : CHAR( s );
+      refs[ i ].length = static_cast< rapidjson::SizeType >( Rf_length( s ) );
+    }
+  }
+
+  // STRSXP values; NA is written as null. Strings need escaping, so go through
+  // the writer one at a time
+  template< typename Writer >
+  inline void write_strings( Writer& writer, SEXP values, R_xlen_t start, R_xlen_t n, R_xlen_t stride = 1 ) {
+
+    R_xlen_t i;
+    R_xlen_t idx;
+
+    for( i = 0, idx = start; i < n; ++i, idx += stride ) {
+      SEXP s = STRING_ELT( values, idx );
+      if( s == NA_STRING ) {
+        writer.Null();
+      } else {
+        writer.String( CHAR( s ), static_cast< rapidjson::SizeType >( Rf_length( s ) ) );
+      }
+    }
+  }
+
+  // as above, from string_refs, without the R API
+  template< typename Writer >
+  inline void write_strings( Writer& writer, const string_ref* values, R_xlen_t n, R_xlen_t stride = 1 ) {
+
+    R_xlen_t i;
+    R_xlen_t idx;
+
+    for( i = 0, idx = 0; i < n; ++i, idx += stride ) {
+      if( values[ idx ].chars == NULL ) {
+        writer.Null();
+      } else {
+        writer.String( values[ idx ].chars, values[ idx ].length );
+      }
+    }
+  }
+
+} // namespace bulk
+} // namespace writers
+} // namespace jsonify
+
+#endif
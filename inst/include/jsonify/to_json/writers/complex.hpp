@@ -5,6 +5,9 @@
 #include "jsonify/to_json/utils.hpp"
 #include "jsonify/to_json/dates/dates.hpp"
 #include "jsonify/to_json/writers/simple.hpp"
+#include "jsonify/to_json/writers/factors.hpp"
+#include "jsonify/to_json/writers/policy.hpp"
+#include "jsonify/stats.hpp"
 #include <math.h>
 
 using namespace rapidjson;
@@ -13,6 +16,26 @@ namespace jsonify {
 namespace writers {
 namespace complex {
 
+  // Everything is written with the options of a jsonify::writers::policy, which
+  // the api resolves once per call. These are the rest, which are values rather
+  // than switches
+  struct write_options {
+    int digits;
+    jsonify::dates::datetime_format datetime;
+    bool validate_json;   // for the writers made from these options
+  };
+  
+  // list-columns and data.frame-columns recurse back into write_value() from
+  // the column plan, so it's declared (with its default arguments) up-front
+  template< typename Policy, typename Writer >
+  inline void write_value(
+      Writer& writer, 
+      SEXP list_element, 
+      const write_options& opts,
+      R_xlen_t row = -1,   // for when we are recursing into a row of a data.frame
+      bool in_data_frame = false  // for keeping track of when we're in a column of a data.frame
+  );
+
   template < typename Writer >
   inline void switch_vector(
       Writer& writer, 
@@ -67,80 +90,522 @@ namespace complex {
     }
   }
   
-  // working by-row, so we only use a single element of each vector
-  template < typename Writer >
-  inline void switch_vector(
-      Writer& writer, 
-      SEXP& this_vec, 
-      bool& unbox, 
-      int& digits, 
-      bool& numeric_dates, 
-      bool& factors_as_string, 
-      R_xlen_t& row
-    ) {
+  // ---------------------------------------------------------------------------
+  // data.frame column plan
+  // ---------------------------------------------------------------------------
+  // Going by-row, every column used to be fetched by name, dispatched on its
+  // type, wrapped in an Rcpp vector and have its class checked for every cell.
+  // The plan resolves all of that once per data.frame, so the row loop only 
+  // indexes into the column data.
+  enum column_kind {
+    COL_NUMERIC,
+    COL_INTEGER,
+    COL_LOGICAL,
+    COL_STRING,
+    COL_JSON,        // a "json" string column, written as it is
+    COL_FACTOR,
+    COL_DATE,
+    COL_POSIXCT,
+    COL_MATRIX,
+    COL_LIST_MATRIX, // a list with dimensions; each row is an array of its elements
+    COL_LIST,
+    COL_DATA_FRAME
+  };
+  
+  struct column_plan {
+    column_kind kind;
+    int r_type;
+    SEXP col;
+    const char* name;
+    rapidjson::SizeType name_length;
+    const double* dbl;                 // REALSXP data
+    const int* ints;                   // INTSXP & LGLSXP data
+    SEXP levels;                       // factor levels, or list-column names
+    jsonify::writers::factors::level_table factor_levels;
+    R_xlen_t n_row;                    // matrix dimensions
+    R_xlen_t n_col;
+    std::vector< column_plan > nested; // data.frame columns
+    Rcpp::RObject owned;               // 'col', when it's converted from the column
+    std::vector< jsonify::writers::bulk::string_ref > strings; // STRSXP data, when it's written off the main thread
+    std::vector< int > utc_offsets;    // of each POSIXct value, with datetime_offset
+  };
+  
+  inline void make_matrix_plan( SEXP mat, column_plan& c ) {
+    c.kind = COL_MATRIX;
+    c.col = mat;
+    c.r_type = TYPEOF( mat );
+    c.dbl = c.r_type == REALSXP ? REAL( mat ) : NULL;
+    c.ints = c.r_type == INTSXP ? INTEGER( mat ) : ( c.r_type == LGLSXP ? LOGICAL( mat ) : NULL );
+    c.n_row = Rf_nrows( mat );
+    c.n_col = Rf_ncols( mat );
+  }
+  
+  template< typename Policy >
+  inline void make_column_plan(
+      SEXP df,
+      const jsonify::dates::datetime_format& datetime,
+      std::vector< column_plan >& plan
+  ) {
     
-    switch( TYPEOF( this_vec ) ) {
-    case REALSXP: {
+    R_xlen_t df_col;
+    R_xlen_t n_cols = Rf_xlength( df );
+    SEXP column_names = Rf_getAttrib( df, R_NamesSymbol );
+    
+    plan.clear();
+    plan.resize( n_cols );
+    
+    for( df_col = 0; df_col < n_cols; ++df_col ) {
+      
+      column_plan& c = plan[ df_col ];
+      SEXP this_vec = VECTOR_ELT( df, df_col );
+      SEXP this_name = STRING_ELT( column_names, df_col );
+      
+      c.col = this_vec;
+      c.r_type = TYPEOF( this_vec );
+      c.name = CHAR( this_name );
+      c.name_length = static_cast< rapidjson::SizeType >( Rf_length( this_name ) );
+      c.dbl = NULL;
+      c.ints = NULL;
+      c.levels = R_NilValue;
+      c.n_row = 0;
+      c.n_col = 0;
+      c.kind = COL_STRING;
       
       if( Rf_isMatrix( this_vec ) ) {
-        Rcpp::NumericMatrix nm = Rcpp::as< Rcpp::NumericMatrix >( this_vec );
-        jsonify::writers::simple::write_value( writer, nm, row, unbox );
-      } else {
-        
-        Rcpp::NumericVector nv = Rcpp::as< Rcpp::NumericVector >( this_vec );
-        jsonify::writers::simple::write_value( writer, nv, row, digits, numeric_dates );
+        if( c.r_type == VECSXP ) {
+          c.kind = COL_LIST_MATRIX;
+          c.n_row = Rf_nrows( this_vec );
+          c.n_col = Rf_ncols( this_vec );
+        } else if( c.r_type == REALSXP || c.r_type == INTSXP || c.r_type == LGLSXP || c.r_type == STRSXP ) {
+          make_matrix_plan( this_vec, c );
+        } else {
+          // e.g. complex; written as strings. Coercing keeps the dimensions
+          c.owned = Rf_coerceVector( this_vec, STRSXP );
+          make_matrix_plan( c.owned, c );
+        }
+        continue;
       }
-    break;
+      
+      switch( c.r_type ) {
+      case REALSXP: {
+        c.dbl = REAL( this_vec );
+        if ( !Policy::numeric_dates && Rf_inherits( this_vec, "Date" ) ) {
+          c.kind = COL_DATE;
+        } else if ( !Policy::numeric_dates && Rf_inherits( this_vec, "POSIXt" ) ) {
+          c.kind = COL_POSIXCT;
+        } else {
+          c.kind = COL_NUMERIC;
+        }
+        break;
+      }
+      case INTSXP: {
+        c.ints = INTEGER( this_vec );
+        if ( Policy::factors_as_string && Rf_isFactor( this_vec ) ) {
+          c.kind = COL_FACTOR;
+          c.levels = Rf_getAttrib( this_vec, R_LevelsSymbol );
+          c.factor_levels.build( c.levels );
+        } else if ( !Policy::numeric_dates && Rf_inherits( this_vec, "Date" ) ) {
+          c.kind = COL_DATE;
+        } else if ( !Policy::numeric_dates && Rf_inherits( this_vec, "POSIXt" ) ) {
+          c.kind = COL_POSIXCT;
+        } else {
+          c.kind = COL_INTEGER;
+        }
+        break;
+      }
+      case LGLSXP: {
+        c.ints = LOGICAL( this_vec );
+        c.kind = COL_LOGICAL;
+        break;
+      }
+      case STRSXP: {
+        c.kind = Rf_inherits( this_vec, "json" ) ? COL_JSON : COL_STRING;
+        break;
+      }
+      case VECSXP: {
+        if( Rf_inherits( this_vec, "data.frame" ) ) {
+          c.kind = COL_DATA_FRAME;
+          make_column_plan< Policy >( this_vec, datetime, c.nested );
+        } else {
+          c.kind = COL_LIST;
+          c.levels = Rf_getAttrib( this_vec, R_NamesSymbol );
+        }
+        break;
+      }
+      default: {
+        // anything else (e.g. complex or raw) is written as strings, as 
+        // as.character() makes them, so it's converted once here
+        c.owned = Rcpp::as< Rcpp::StringVector >( this_vec );
+        c.col = c.owned;
+        c.r_type = STRSXP;
+      }
+      }
+      
+      if( c.kind == COL_POSIXCT && datetime.offset ) {
+        jsonify::dates::utc_offsets( this_vec, c.utc_offsets );
+      }
+    }
+  }
+  
+  // writes 'n' elements of a matrix, starting at 'start' and stepping through
+  // the column-major data by 'stride', as an array (or a scalar if unboxed). 
+  // As simple::write_matrix_slice(), but from the plan's data pointers, so it 
+  // can be used off the main thread (once a string matrix has its 'strings')
+  template< typename Policy, typename Writer >
+  inline void write_matrix_slice(
+      Writer& writer,
+      const column_plan& c,
+      R_xlen_t start,
+      R_xlen_t n,
+      R_xlen_t stride,
+      int digits
+  ) {
+    
+    bool will_unbox = jsonify::utils::should_unbox( n, Policy::unbox );
+    
+    jsonify::utils::start_array( writer, will_unbox );
+    switch( c.r_type ) {
+    case REALSXP: {
+      jsonify::writers::bulk::write_doubles( writer, c.dbl + start, n, stride, digits );
+      break;
     }
     case INTSXP: {
-      if( Rf_isMatrix( this_vec ) ) {
-        
-        Rcpp::IntegerMatrix im = Rcpp::as< Rcpp::IntegerMatrix >( this_vec );
-        jsonify::writers::simple::write_value( writer, im, row, unbox );
+      jsonify::writers::bulk::write_integers( writer, c.ints + start, n, stride );
+      break;
+    }
+    case LGLSXP: {
+      jsonify::writers::bulk::write_logicals( writer, c.ints + start, n, stride );
+      break;
+    }
+    default: {
+      if( c.strings.empty() ) {
+        jsonify::writers::bulk::write_strings( writer, c.col, start, n, stride );
       } else {
-        
-        Rcpp::IntegerVector iv = Rcpp::as< Rcpp::IntegerVector >( this_vec );
-        jsonify::writers::simple::write_value( writer, iv, row, numeric_dates, factors_as_string );
+        jsonify::writers::bulk::write_strings( writer, c.strings.data() + start, n, stride );
+      }
+    }
+    }
+    jsonify::utils::end_array( writer, will_unbox );
+  }
+  
+  // matrix-columns have never been rounded
+  template< typename Policy, typename Writer >
+  inline void write_matrix_row(
+      Writer& writer,
+      const column_plan& c,
+      R_xlen_t row
+  ) {
+    write_matrix_slice< Policy >( writer, c, row, c.n_col, c.n_row, -1 );
+  }
+  
+  // "json" strings are already JSON, so are spliced into the output rather than
+  // written as (escaped) strings
+  template< typename Writer >
+  inline void write_json_string( Writer& writer, SEXP s ) {
+    if( s == NA_STRING ) {
+      writer.Null();
+    } else {
+      writer.Json( CHAR( s ), static_cast< size_t >( Rf_length( s ) ) );
+    }
+  }
+  
+  // a single "json" string is a value in itself (e.g. the result of to_json()), 
+  // unless it's a data.frame column; otherwise they're an array
+  template< typename Writer >
+  inline void write_json_strings( Writer& writer, SEXP json, bool in_data_frame ) {
+    R_xlen_t n = Rf_xlength( json );
+    R_xlen_t i;
+    if( n == 1 && !in_data_frame ) {
+      write_json_string( writer, STRING_ELT( json, 0 ) );
+      return;
+    }
+    writer.StartArray();
+    for( i = 0; i < n; ++i ) {
+      write_json_string( writer, STRING_ELT( json, i ) );
+    }
+    writer.EndArray();
+  }
+  
+  template< typename Policy, typename Writer >
+  inline void write_row(
+      Writer& writer,
+      const std::vector< column_plan >& plan,
+      R_xlen_t row,
+      const write_options& opts
+  );
+  
+  template< typename Policy, typename Writer >
+  inline void write_cell(
+      Writer& writer,
+      const column_plan& c,
+      R_xlen_t row,
+      const write_options& opts
+  ) {
+    
+    switch( c.kind ) {
+    case COL_NUMERIC: {
+      double d = c.dbl[ row ];
+      if( ISNAN( d ) ) {
+        writer.Null();
+      } else {
+        jsonify::writers::scalars::write_number< Policy::round >( writer, d, opts.digits );
       }
       break;
     }
-    case LGLSXP: {
-      if( Rf_isMatrix( this_vec ) ) {
-        Rcpp::LogicalMatrix lm = Rcpp::as< Rcpp::LogicalMatrix >( this_vec );
-        jsonify::writers::simple::write_value( writer, lm, row, unbox );
-     } else {
-        Rcpp::LogicalVector lv = Rcpp::as< Rcpp::LogicalVector >( this_vec );
-        jsonify::writers::simple::write_value( writer, lv, row );
+    case COL_INTEGER: {
+      if( c.ints[ row ] == NA_INTEGER ) {
+        writer.Null();
+      } else {
+        writer.Int( c.ints[ row ] );
       }
       break;
     }
-    default: {
-      if( Rf_isMatrix( this_vec ) ) {
-        Rcpp::StringMatrix sm = Rcpp::as< Rcpp::StringMatrix >( this_vec );
-        jsonify::writers::simple::write_value( writer, sm, row, unbox );
+    case COL_LOGICAL: {
+      if( c.ints[ row ] == NA_LOGICAL ) {
+        writer.Null();
+      } else {
+        writer.Bool( c.ints[ row ] != 0 );
+      }
+      break;
+    }
+    case COL_STRING: {
+      if( !c.strings.empty() ) {
+        jsonify::writers::bulk::write_strings( writer, c.strings.data() + row, 1 );
+        break;
+      }
+      SEXP s = STRING_ELT( c.col, row );
+      if( s == NA_STRING ) {
+        writer.Null();
       } else {
-        Rcpp::StringVector sv = Rcpp::as< Rcpp::StringVector >( this_vec );
-        jsonify::writers::simple::write_value( writer, sv, row );
+        writer.String( CHAR( s ), static_cast< rapidjson::SizeType >( Rf_length( s ) ) );
       }
       break;
     }
+    case COL_JSON: {
+      write_json_string( writer, STRING_ELT( c.col, row ) );
+      break;
+    }
+    case COL_FACTOR: {
+      c.factor_levels.write( writer, c.ints[ row ] );
+      break;
+    }
+    case COL_DATE: {
+      if( c.r_type == REALSXP ) {
+        jsonify::dates::write_date( writer, c.dbl[ row ] );
+      } else {
+        jsonify::dates::write_date( writer, c.ints[ row ] );
+      }
+      break;
+    }
+    case COL_POSIXCT: {
+      int offset = c.utc_offsets.empty() ? 0 : c.utc_offsets[ row ];
+      if( c.r_type == REALSXP ) {
+        jsonify::dates::write_datetime( writer, c.dbl[ row ], opts.datetime, offset );
+      } else {
+        jsonify::dates::write_datetime( writer, c.ints[ row ], opts.datetime, offset );
+      }
+      break;
+    }
+    case COL_MATRIX: {
+      write_matrix_row< Policy >( writer, c, row );
+      break;
+    }
+    case COL_LIST: {
+      // a list-column element is written 'as-is'; if the list is named the 
+      // element is wrapped in an object keyed by its name (ISSUE #32)
+      SEXP element = VECTOR_ELT( c.col, row );
+      if( !Rf_isNull( c.levels ) ) {
+        writer.StartObject();
+        writer.String( CHAR( STRING_ELT( c.levels, row ) ) );
+        write_value< Policy >( writer, element, opts );
+        writer.EndObject();
+      } else {
+        write_value< Policy >( writer, element, opts );
+      }
+      break;
+    }
+    case COL_LIST_MATRIX: {
+      R_xlen_t j;
+      writer.StartArray();
+      for( j = 0; j < c.n_col; ++j ) {
+        write_value< Policy >( writer, VECTOR_ELT( c.col, row + j * c.n_row ), opts );
+      }
+      writer.EndArray();
+      break;
+    }
+    default: {
+      // COL_DATA_FRAME
+      write_row< Policy >( writer, c.nested, row, opts );
+    }
     }
   }
-
+  
+  template< typename Policy, typename Writer >
+  inline void write_row(
+      Writer& writer,
+      const std::vector< column_plan >& plan,
+      R_xlen_t row,
+      const write_options& opts
+  ) {
+    writer.StartObject();
+    for( const auto& c : plan ) {
+      writer.String( c.name, c.name_length );
+      write_cell< Policy >( writer, c, row, opts );
+    }
+    writer.EndObject();
+  }
+  
+  // a data.frame row, for the element writers of the parallel writers
+  template< typename Policy >
+  struct row_writer {
+    const std::vector< column_plan >& plan;
+    const write_options& opts;
+    
+    template< typename Writer >
+    void operator()( Writer& writer, R_xlen_t row ) const {
+      write_row< Policy >( writer, plan, row, opts );
+    }
+  };
+  
+  // rows [start, end), one after the other
+  template< typename Policy, typename Writer >
+  inline void write_rows(
+      Writer& writer,
+      const std::vector< column_plan >& plan,
+      R_xlen_t start,
+      R_xlen_t end,
+      const write_options& opts
+  ) {
+    R_xlen_t row;
+    for( row = start; row < end; ++row ) {
+      write_row< Policy >( writer, plan, row, opts );
+    }
+  }
+  
+  // Lists (and pairlists) of lists are written without recursion, from a stack of
+  // the lists which have been started but not finished, so the depth of nesting
+  // is only limited by memory. Anything else in a list goes back through
+  // write_value(), which is only ever one level deep for them.
+  
+  struct list_frame {
+    SEXP list;          // the VECSXP, or the pairlist
+    SEXP names;         // the VECSXP's names, or R_NilValue
+    SEXP next;          // the next cell of a pairlist
+    R_xlen_t i;
+    R_xlen_t n;
+    bool is_pairlist;
+    bool has_names;
+    bool in_data_frame;
+  };
+  
+  // a list which is written as a list, not as a data.frame or matrix
+  inline bool is_plain_list( SEXP x ) {
+    int type = TYPEOF( x );
+    if( type != VECSXP && type != LISTSXP && type != LANGSXP ) {
+      return false;
+    }
+    return !Rf_isMatrix( x ) && !Rf_inherits( x, "data.frame" );
+  }
+  
+  inline bool pairlist_has_tags( SEXP x ) {
+    for( ; x != R_NilValue; x = CDR( x ) ) {
+      if( TAG( x ) != R_NilValue ) {
+        return true;
+      }
+    }
+    return false;
+  }
+  
+  inline list_frame make_list_frame( SEXP x, bool in_data_frame ) {
+    list_frame f;
+    f.list = x;
+    f.i = 0;
+    f.in_data_frame = in_data_frame;
+    f.is_pairlist = TYPEOF( x ) != VECSXP;
+    if( f.is_pairlist ) {
+      f.names = R_NilValue;
+      f.next = x;
+      f.n = Rf_xlength( x );
+      f.has_names = pairlist_has_tags( x );
+    } else {
+      f.names = Rf_getAttrib( x, R_NamesSymbol );
+      f.next = R_NilValue;
+      f.n = Rf_xlength( x );
+      f.has_names = !Rf_isNull( f.names );
+    }
+    return f;
+  }
+  
+  // the next element of the list, writing its name if the list has names
   template< typename Writer >
+  inline SEXP next_list_element( Writer& writer, list_frame& f ) {
+    SEXP element;
+    if( f.is_pairlist ) {
+      element = CAR( f.next );
+      if( f.has_names ) {
+        SEXP tag = TAG( f.next );
+        writer.String( tag == R_NilValue ? "" : CHAR( PRINTNAME( tag ) ) );
+      }
+      f.next = CDR( f.next );
+    } else {
+      element = VECTOR_ELT( f.list, f.i );
+      if( f.has_names ) {
+        writer.String( CHAR( STRING_ELT( f.names, f.i ) ) );
+      }
+    }
+    ++f.i;
+    return element;
+  }
+  
+  template< typename Policy, typename Writer >
+  inline void write_list(
+      Writer& writer,
+      SEXP lst,
+      bool in_data_frame,
+      const write_options& opts
+  ) {
+    std::vector< list_frame > stack;
+    
+    // issue 44 - a list-column in a data.frame shouldn't be nested inside another array
+    stack.push_back( make_list_frame( lst, in_data_frame ) );
+    jsonify::utils::writer_starter( writer, stack.back().has_names, stack.back().in_data_frame );
+    
+    while( !stack.empty() ) {
+      list_frame& f = stack.back();
+      
+      if( f.i == f.n ) {
+        jsonify::utils::writer_ender( writer, f.has_names, f.in_data_frame );
+        stack.pop_back();
+        continue;
+      }
+      
+      SEXP element = next_list_element( writer, f );
+      
+      if( !is_plain_list( element ) ) {
+        // setting in_data_frame to false because we're no longer at the data.frame top-level
+        write_value< Policy >( writer, element, opts );
+      } else if( Rf_xlength( element ) == 0 ) {
+        writer.StartArray();
+        writer.EndArray();
+      } else {
+        // 'f' is invalidated by the push
+        stack.push_back( make_list_frame( element, false ) );
+        jsonify::utils::writer_starter( writer, stack.back().has_names, stack.back().in_data_frame );
+      }
+    }
+  }
+
+  template< typename Policy, typename Writer >
   inline void write_value(
       Writer& writer, 
       SEXP list_element, 
-      bool unbox = false, 
-      int digits = -1, 
-      bool numeric_dates = true,
-      bool factors_as_string = true, 
-      std::string by = "row", 
-      R_xlen_t row = -1,   // for when we are recursing into a row of a data.frame
-      bool in_data_frame = false  // for keeping track of when we're in a column of a data.frame
+      const write_options& opts,
+      R_xlen_t row,
+      bool in_data_frame
       ) {
     
-    R_xlen_t i, df_col, df_row;
+    jsonify::stats::timer t( jsonify::stats::STAGE_WRITE_VALUE );
+    R_xlen_t df_col;
     
     if( Rf_isNull( list_element ) ) {
       writer.StartObject();
@@ -152,23 +617,19 @@ namespace complex {
       
       switch( TYPEOF( list_element ) ) {
       case REALSXP: {
-        Rcpp::NumericMatrix nm = Rcpp::as< Rcpp::NumericMatrix >( list_element );
-        return jsonify::writers::simple::write_value( writer, nm, unbox, digits, by );
-        break;
-      }
-      case INTSXP: {
-        Rcpp::IntegerMatrix im = Rcpp::as< Rcpp::IntegerMatrix >( list_element );
-        return jsonify::writers::simple::write_value( writer, im, unbox, by );
+        return jsonify::writers::simple::write_matrix< Policy >( writer, list_element, opts.digits );
         break;
       }
-      case LGLSXP: {
-        Rcpp::LogicalMatrix lm = Rcpp::as< Rcpp::LogicalMatrix >( list_element );
-        return jsonify::writers::simple::write_value( writer, lm, unbox, by );
+      case INTSXP: {}
+      case LGLSXP: {}
+      case STRSXP: {
+        return jsonify::writers::simple::write_matrix< Policy >( writer, list_element, -1 );
         break;
       }
       default :{
+        // e.g. complex; written as strings
         Rcpp::StringMatrix sm = Rcpp::as< Rcpp::StringMatrix >( list_element );
-        return jsonify::writers::simple::write_value( writer, sm, unbox, by );
+        return jsonify::writers::simple::write_matrix< Policy >( writer, sm, -1 );
         break;
       }
       }
@@ -180,106 +641,36 @@ namespace complex {
       R_xlen_t n_rows = df.nrows();
       Rcpp::StringVector column_names = df.names();
       
-      // issue 59
-      // moving the factor_as_string conersion as high up as possible, 
-      // so it works on the whole vector. 
-      if( factors_as_string ) {
-        jsonify::utils::factors_to_string( df );
-      }
-      
-      // issue 60
-      if( !numeric_dates ) {
-        int tp;
-
-        for( df_col = 0; df_col < n_cols; ++df_col ) {
-          const char * col_name = column_names[ df_col ];
-          tp = TYPEOF( df[ col_name ] );
-
-          if( tp == REALSXP ) {
-            Rcpp::NumericVector nv_dte = Rcpp::as< Rcpp::NumericVector >( df[ col_name ] );
-            Rcpp::CharacterVector cls = jsonify::utils::getRClass( nv_dte );
-
-            if( jsonify::dates::is_in( "Date", cls ) ) {
-
-              Rcpp::StringVector sv_dte = jsonify::dates::date_to_string( nv_dte );
-              df[ col_name ] = sv_dte;
-
-            } else if (jsonify::dates::is_in( "POSIXt", cls ) ) {
-
-              Rcpp::StringVector sv_psx = jsonify::dates::posixct_to_string( nv_dte );
-              df[ col_name ] = sv_psx;
-            }
-          }
-        }
-      }
-      
+      // issue 59 & 60
+      // factors and dates are converted as they're written, either by the column plan
+      // (by-row) or by the simple writers (by-column), so the input is never modified
       
-      if ( by == "column") {
+      if ( Policy::by_column ) {
         writer.StartObject();
         
         for( df_col = 0; df_col < n_cols; ++df_col ) {
 
           const char *h = column_names[ df_col ];
           writer.String( h );
-          SEXP this_vec = df[ h ];
-          write_value( writer, this_vec, unbox, digits, numeric_dates, factors_as_string, by, -1, in_data_frame );
+          SEXP this_vec = VECTOR_ELT( df, df_col );
+          write_value< Policy >( writer, this_vec, opts, -1, in_data_frame );
           
         }
         writer.EndObject();
         
       } else { // by == "row"
         
+        std::vector< column_plan > plan;
+        make_column_plan< Policy >( df, opts.datetime, plan );
+        
         if ( row >= 0 ) {
           
-          writer.StartObject();
-          for( df_col = 0; df_col < n_cols; df_col++ ) {
-            
-            const char *h = column_names[ df_col ];
-            writer.String( h );
-            
-            SEXP this_vec = df[ h ];
-            
-            switch( TYPEOF( this_vec ) ) {
-            
-            case VECSXP: {
-              Rcpp::List lst = Rcpp::as< Rcpp::List >( this_vec );
-              write_value( writer, lst, unbox, digits, numeric_dates, factors_as_string, by, row, in_data_frame );
-              break;
-            }
-            default: {
-              switch_vector( writer, this_vec, unbox, digits, numeric_dates, factors_as_string, row );
-            }
-            } // end switch
-            
-          } // end for
-          writer.EndObject();
+          write_rows< Policy >( writer, plan, row, row + 1, opts );
           
         } else {
           
           writer.StartArray();
-          
-          for( df_row = 0; df_row < n_rows; df_row++ ) {
-            writer.StartObject();
-            
-            for( df_col = 0; df_col < n_cols; df_col++ ) {
-              
-              const char *h = column_names[ df_col ];
-              writer.String( h );
-              SEXP this_vec = df[ h ];
-              
-              switch( TYPEOF( this_vec ) ) {
-              case VECSXP: {
-                Rcpp::List lst = Rcpp::as< Rcpp::List >( this_vec );
-                write_value( writer, lst, unbox, digits, numeric_dates, factors_as_string, by, df_row, in_data_frame );
-                break;
-              }
-              default: {
-                switch_vector( writer, this_vec, unbox, digits, numeric_dates, factors_as_string, df_row );
-              }
-              }
-            }
-            writer.EndObject();
-          } // end for
+          write_rows< Policy >( writer, plan, 0, n_rows, opts );
           writer.EndArray();
         } // end if
       }
@@ -290,91 +681,37 @@ namespace complex {
       
       case VECSXP: {
      
-        // the case where the list item is a row of a data.frame
-        // ISSUE #32
-        Rcpp::List temp_lst = Rcpp::as< Rcpp::List >( list_element );
-        bool has_names;
-        
-        has_names = temp_lst.hasAttribute("names");
-        
-        Rcpp::List lst(1);
-        if( row >= 0 ) {   // we came in from a data.frame, going by-row
-          // ISSUE 32
-          lst[0] = temp_lst[ row ];
-          
-          if( temp_lst.hasAttribute("names") ) {
-            Rcpp::CharacterVector templstnames = temp_lst.names();
-            const char* this_name = templstnames[ row ];
-            lst.names() = this_name;
-          }
-
-          write_value( writer, lst, unbox, digits, numeric_dates, factors_as_string, by, -1, in_data_frame );  
-          
-        } else {
-          lst = temp_lst;
-
-          R_xlen_t n = lst.size();
-          
-          if ( n == 0 ) {
-            writer.StartArray();
-            writer.EndArray();
-            break;
-          }
-          
-          // LIST NAMES
-          // issue 53
-          Rcpp::CharacterVector list_names( lst.size() ); // initialises an empty-string vector
-          has_names = lst.hasAttribute("names");
-          
-          if ( has_names ) {
-            Rcpp::CharacterVector temp_names = lst.names();
-            for( i = 0; i < n; ++i ) {
-              list_names[i] = temp_names[i] == "" ? list_names[i] : temp_names[i];
-            }
-          }
-          // END LIST NAMES
-          
-          // issue 44
-          // list-column in a data.frame shouldn't be nested inside another array
-          jsonify::utils::writer_starter( writer, has_names, in_data_frame );
-          
-          for ( i = 0; i < n; ++i ) {
-            
-            SEXP recursive_list = lst[ i ];
-            if ( has_names ) {
-              const char *s = list_names[ i ];
-              writer.String( s );
-            }
-            // setting in_data_frame to false because we're no longer at the data.frame top-level
-            write_value( writer, recursive_list, unbox, digits, numeric_dates, factors_as_string, by, -1, false ); 
-          }
-          
-          jsonify::utils::writer_ender( writer, has_names, in_data_frame );
-        } // end if (by row)
+        // list-columns of a data.frame going by-row are written from the column
+        // plan, a cell at a time, so never come through here
+        if ( Rf_xlength( list_element ) == 0 ) {
+          writer.StartArray();
+          writer.EndArray();
+          break;
+        }
+        write_list< Policy >( writer, list_element, in_data_frame, opts );
         break;
       }
         
       case REALSXP: {
         
         Rcpp::NumericVector nv = Rcpp::as< Rcpp::NumericVector >( list_element );
-        jsonify::writers::simple::write_value( writer, nv, unbox, digits, numeric_dates );
+        jsonify::writers::simple::write_value< Policy >( writer, nv, opts.digits, opts.datetime );
         break;
       }
       case INTSXP: {
         Rcpp::IntegerVector iv = Rcpp::as< Rcpp::IntegerVector >( list_element );
-        jsonify::writers::simple::write_value( writer, iv, unbox, numeric_dates, factors_as_string );
+        jsonify::writers::simple::write_value< Policy >( writer, iv, opts.datetime );
         break;
       }
       case LGLSXP: {
         Rcpp::LogicalVector lv = Rcpp::as< Rcpp::LogicalVector >( list_element );
-        jsonify::writers::simple::write_value( writer, lv, unbox );
+        jsonify::writers::simple::write_value< Policy >( writer, lv );
         break;
       }
       case LISTSXP: {} // lists of dotted paires
       case LANGSXP: {   // language constructs (special lists)
-        Rcpp::Pairlist s = Rcpp::as< Rcpp::Pairlist >( list_element );
-        Rcpp::List l = Rcpp::as< Rcpp::List >( s );
-        write_value( writer, l, unbox, digits, numeric_dates, factors_as_string, by );
+        // written as as.list() would convert it, but without the copy
+        write_list< Policy >( writer, list_element, false, opts );
         break;
       }
       case CLOSXP: {}   // closures
@@ -383,17 +720,58 @@ namespace complex {
       case ENVSXP: {}
       case FUNSXP: {
         Rcpp::List l = Rcpp::as< Rcpp::List >( list_element );
-        write_value( writer, l, unbox, digits, numeric_dates, factors_as_string, by );
+        write_value< Policy >( writer, l, opts );
         break;
       }
+      case STRSXP: {
+        if( Rf_inherits( list_element, "json" ) ) {
+          write_json_strings( writer, list_element, in_data_frame );
+          break;
+        }
+      } // other strings are written by default
       default: {
         Rcpp::StringVector sv = Rcpp::as< Rcpp::StringVector >( list_element );
-        jsonify::writers::simple::write_value( writer, sv, unbox );
+        jsonify::writers::simple::write_value< Policy >( writer, sv );
         break;
       }
       }
     }
   }
+  
+  // a value, with its options resolved into a policy
+  template< typename Writer >
+  struct value_writer {
+    Writer& writer;
+    SEXP list_element;
+    const write_options& opts;
+    R_xlen_t row;
+    bool in_data_frame;
+    
+    template< typename Policy >
+    void operator()( Policy ) {
+      write_value< Policy >( writer, list_element, opts, row, in_data_frame );
+    }
+  };
+  
+  // write_value() with its options at run-time, for writing a single value. 
+  // jsonify's own writers resolve the policy once, at the top
+  template< typename Writer >
+  inline void write_value(
+      Writer& writer, 
+      SEXP list_element, 
+      bool unbox = false, 
+      int digits = -1, 
+      bool numeric_dates = true,
+      bool factors_as_string = true, 
+      const std::string& by = "row", 
+      R_xlen_t row = -1,
+      bool in_data_frame = false,
+      const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+  ) {
+    write_options opts = { digits, datetime, false };
+    value_writer< Writer > vw = { writer, list_element, opts, row, in_data_frame };
+    jsonify::writers::policy::dispatch( unbox, digits, numeric_dates, factors_as_string, jsonify::writers::policy::by_column( by ), vw );
+  }
 
 } // namespace complex
 } // namespace writers
@@ -0,0 +1,144 @@
+#ifndef JSONIFY_WRITERS_ESCAPE_H
+#define JSONIFY_WRITERS_ESCAPE_H
+
+#include <cstddef>
+#include <cstring>
+
+// Finding the bytes of a string which need escaping in JSON: control
+// characters (< 0x20), '"' and '\'. Everything else, including UTF-8, is
+// copied as-is, which is what rapidjson::Writer does.
+//
+// On x86 the string is scanned 16 (SSE2) or 32 (AVX2, if the CPU has it)
+// bytes at a time; elsewhere one byte at a time.
+
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) ) && defined(__SSE2__)
+#define JSONIFY_ESCAPE_SSE2 1
+#include <emmintrin.h>
+#if !defined(__clang__) || ( __clang_major__ >= 4 )
+#define JSONIFY_ESCAPE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+namespace jsonify {
+namespace writers {
+namespace escape {
+
+  // the character after the '\', or 'u' for "\u00XX" (as in rapidjson)
+  inline const char* escape_table() {
+    static const char table[ 256 ] = {
+      'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u', // 0x00
+      'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', // 0x10
+        0,   0, '"',   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0, // 0x20
+        0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0, // 0x30
+        0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0, // 0x40
+        0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,'\\',   0,   0,   0  // 0x50
+      // the rest are 0
+    };
+    return table;
+  }
+
+  inline const char* find_escape_scalar( const char* p, const char* end ) {
+    const char* table = escape_table();
+    while( p < end && !table[ static_cast< unsigned char >( *p ) ] ) {
+      ++p;
+    }
+    return p;
+  }
+
+#ifdef JSONIFY_ESCAPE_SSE2
+
+  inline int count_trailing_zeros( unsigned int mask ) {
+    return __builtin_ctz( mask );
+  }
+
+  inline const char* find_escape_sse2( const char* p, const char* end ) {
+    const __m128i quote = _mm_set1_epi8( '"' );
+    const __m128i backslash = _mm_set1_epi8( '\\' );
+    const __m128i control = _mm_set1_epi8( 0x1F );
+
+    for( ; end - p >= 16; p += 16 ) {
+      __m128i v = _mm_loadu_si128( reinterpret_cast< const __m128i* >( p ) );
+      // v <= 0x1F (unsigned) iff max( v, 0x1F ) == 0x1F
+      __m128i is_control = _mm_cmpeq_epi8( _mm_max_epu8( v, control ), control );
+      __m128i is_special = _mm_or_si128(
+        _mm_or_si128( _mm_cmpeq_epi8( v, quote ), _mm_cmpeq_epi8( v, backslash ) ),
+        is_control
+      );
+      unsigned int mask = static_cast< unsigned int >( _mm_movemask_epi8( is_special ) );
+      if( mask != 0 ) {
+        return p + count_trailing_zeros( mask );
+      }
+    }
+    return find_escape_scalar( p, end );
+  }
+
+#endif
+
+#ifdef JSONIFY_ESCAPE_AVX2
+
+  __attribute__(( target( "avx2" ) ))
+  inline const char* find_escape_avx2( const char* p, const char* end ) {
+    const __m256i quote = _mm256_set1_epi8( '"' );
+    const __m256i backslash = _mm256_set1_epi8( '\\' );
+    const __m256i control = _mm256_set1_epi8( 0x1F );
+
+    for( ; end - p >= 32; p += 32 ) {
+      __m256i v = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( p ) );
+      __m256i is_control = _mm256_cmpeq_epi8( _mm256_max_epu8( v, control ), control );
+      __m256i is_special = _mm256_or_si256(
+        _mm256_or_si256( _mm256_cmpeq_epi8( v, quote ), _mm256_cmpeq_epi8( v, backslash ) ),
+        is_control
+      );
+      unsigned int mask = static_cast< unsigned int >( _mm256_movemask_epi8( is_special ) );
+      if( mask != 0 ) {
+        return p + count_trailing_zeros( mask );
+      }
+    }
+    return find_escape_sse2( p, end );
+  }
+
+  inline bool has_avx2() {
+    // checked once; thread-safe initialisation of a local static (C++11)
+    static const bool avx2 = __builtin_cpu_supports( "avx2" ) != 0;
+    return avx2;
+  }
+
+#endif
+
+  // the first byte in [p, end) which needs escaping, or 'end'
+  inline const char* find_escape( const char* p, const char* end ) {
+#if defined(JSONIFY_ESCAPE_AVX2)
+    if( has_avx2() ) {
+      return find_escape_avx2( p, end );
+    }
+    return find_escape_sse2( p, end );
+#elif defined(JSONIFY_ESCAPE_SSE2)
+    return find_escape_sse2( p, end );
+#else
+    return find_escape_scalar( p, end );
+#endif
+  }
+
+  // writes the escape sequence for 'c' (which needs escaping) to 'buffer',
+  // returning its length
+  inline int escape_char( unsigned char c, char* buffer ) {
+    static const char hex_digits[] = "0123456789ABCDEF";
+    char e = escape_table()[ c ];
+    buffer[ 0 ] = '\\';
+    buffer[ 1 ] = e;
+    if( e != 'u' ) {
+      return 2;
+    }
+    buffer[ 2 ] = '0';
+    buffer[ 3 ] = '0';
+    buffer[ 4 ] = hex_digits[ c >> 4 ];
+    buffer[ 5 ] = hex_digits[ c & 0xF ];
+    return 6;
+  }
+
+} // namespace escape
+} // namespace writers
+} // namespace jsonify
+
+#endif
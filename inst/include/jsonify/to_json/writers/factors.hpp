@@ -0,0 +1,94 @@
+#ifndef JSONIFY_WRITERS_FACTORS_H
+#define JSONIFY_WRITERS_FACTORS_H
+
+#include <Rcpp.h>
+#include "rapidjson/writer.h"
+#include "rapidjson/stringbuffer.h"
+#include "jsonify/to_json/writers/json_writer.hpp"
+
+#include <string>
+#include <vector>
+
+// Factors are written from a table of their levels, each already encoded as a
+// JSON string (quoted and escaped), so a level is escaped once however many
+// rows use it, and writing a value is a lookup by its integer code.
+
+namespace jsonify {
+namespace writers {
+namespace factors {
+
+  class level_table {
+  public:
+
+    level_table() {}
+
+    explicit level_table( SEXP levels ) {
+      build( levels );
+    }
+
+    inline void build( SEXP levels ) {
+
+      R_xlen_t i;
+      R_xlen_t n = Rf_isNull( levels ) ? 0 : Rf_xlength( levels );
+
+      rapidjson::StringBuffer sb;
+      jsonify::writers::json_writer< rapidjson::StringBuffer > writer( sb );
+
+      offsets_.resize( n + 1 );
+      offsets_[ 0 ] = 0;
+
+      for( i = 0; i < n; ++i ) {
+        SEXP s = STRING_ELT( levels, i );
+        writer.Reset( sb );
+        if( s == NA_STRING ) {
+          writer.Null();
+        } else {
+          writer.String( CHAR( s ), static_cast< rapidjson::SizeType >( Rf_length( s ) ) );
+        }
+        offsets_[ i + 1 ] = sb.GetSize();
+      }
+      json_.assign( sb.GetString(), sb.GetSize() );
+    }
+
+    inline R_xlen_t size() const {
+      return static_cast< R_xlen_t >( offsets_.size() ) - 1;
+    }
+
+    // 'code' is the factor's (1-based) integer code. NA and codes without a
+    // level are written as null
+    template< typename Writer >
+    inline void write( Writer& writer, int code ) const {
+      if( code == NA_INTEGER || code < 1 || code > size() ) {
+        writer.Null();
+        return;
+      }
+      size_t start = offsets_[ code - 1 ];
+      size_t length = offsets_[ code ] - start;
+      writer.RawValue( json_.data() + start, length, rapidjson::kStringType );
+    }
+
+  private:
+    std::string json_;
+    std::vector< size_t > offsets_;
+  };
+
+  // a single value, where building the table isn't worth it
+  template< typename Writer >
+  inline void write_level( Writer& writer, SEXP levels, int code ) {
+    if( code == NA_INTEGER || code < 1 || code > Rf_xlength( levels ) ) {
+      writer.Null();
+      return;
+    }
+    SEXP s = STRING_ELT( levels, code - 1 );
+    if( s == NA_STRING ) {
+      writer.Null();
+    } else {
+      writer.String( CHAR( s ), static_cast< rapidjson::SizeType >( Rf_length( s ) ) );
+    }
+  }
+
+} // namespace factors
+} // namespace writers
+} // namespace jsonify
+
+#endif
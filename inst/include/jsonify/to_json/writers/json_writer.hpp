@@ -0,0 +1,136 @@
+#ifndef JSONIFY_WRITERS_JSON_WRITER_H
+#define JSONIFY_WRITERS_JSON_WRITER_H
+
+#include "rapidjson/writer.h"
+#include "jsonify/to_json/utils.hpp"
+#include "jsonify/to_json/writers/escape.hpp"
+#include "jsonify/validate/validate.hpp"
+
+#include <cstring>
+
+namespace jsonify {
+namespace writers {
+
+  // rapidjson::Writer, with strings written by copying the runs of bytes which
+  // don't need escaping in one go, rather than one byte at a time. The output
+  // is identical to rapidjson::Writer's.
+  template< typename OutputStream >
+  class json_writer : public rapidjson::Writer< OutputStream > {
+  public:
+    typedef rapidjson::Writer< OutputStream > base;
+    typedef char Ch;
+
+    explicit json_writer( OutputStream& os, bool validate_json = false ) 
+      : base( os ), validate_json_( validate_json ) {}
+
+    bool String( const Ch* str, rapidjson::SizeType length, bool copy = false ) {
+      (void)copy;
+      this->Prefix( rapidjson::kStringType );
+      return this->EndValue( write_string( str, length ) );
+    }
+
+    bool String( const Ch* str ) {
+      return String( str, static_cast< rapidjson::SizeType >( std::strlen( str ) ) );
+    }
+
+    bool Key( const Ch* str, rapidjson::SizeType length, bool copy = false ) {
+      return String( str, length, copy );
+    }
+
+    bool Key( const Ch* str ) {
+      return String( str );
+    }
+
+    // writes a value which is already JSON (e.g. a "json" string), after checking
+    // it parses if the writer was made with 'validate_json'. It's copied without 
+    // the whitespace between its tokens, so a pretty-printed value is written on 
+    // one line, as the rest of the output is (and as ndjson must be).
+    // An empty (or all whitespace) string has no value to copy, so is a null; 
+    // copying nothing would leave a "," with nothing after it
+    bool Json( const Ch* json, size_t length ) {
+      if( is_blank( json, length ) ) {
+        return this->Null();
+      }
+      if( validate_json_ && !jsonify::validate::validate_json( json, length ) ) {
+        Rcpp::stop("jsonify - invalid JSON in a json object");
+      }
+      // the type is only used by rapidjson's assertions, and a value is never a key
+      this->Prefix( rapidjson::kObjectType );
+      write_compact( json, length );
+      return this->EndValue( true );
+    }
+
+  protected:
+
+    static bool is_space( Ch c ) {
+      return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+
+    static bool is_blank( const Ch* json, size_t length ) {
+      size_t i;
+      for( i = 0; i < length; ++i ) {
+        if( !is_space( json[ i ] ) ) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // copies the runs of 'json' between whitespace outside of its strings, so
+    // compact JSON is a single copy. Whitespace in a string is part of its value
+    // (and a new-line in one is always escaped)
+    void write_compact( const Ch* json, size_t length ) {
+      OutputStream& os = *this->os_;
+      size_t i;
+      size_t start = 0;
+      bool in_string = false;
+      bool escaped = false;
+      for( i = 0; i < length; ++i ) {
+        Ch c = json[ i ];
+        if( in_string ) {
+          if( escaped ) {
+            escaped = false;
+          } else if( c == '\\' ) {
+            escaped = true;
+          } else if( c == '"' ) {
+            in_string = false;
+          }
+        } else if( c == '"' ) {
+          in_string = true;
+        } else if( is_space( c ) ) {
+          jsonify::utils::put_bytes( os, json + start, i - start );
+          start = i + 1;
+        }
+      }
+      jsonify::utils::put_bytes( os, json + start, length - start );
+    }
+
+    bool write_string( const Ch* str, rapidjson::SizeType length ) {
+      OutputStream& os = *this->os_;
+      const char* p = str;
+      const char* end = str + length;
+      char escaped[ 6 ];
+
+      rapidjson::PutReserve( os, 2 + static_cast< size_t >( length ) * 6 );
+      rapidjson::PutUnsafe( os, '\"' );
+      while( p < end ) {
+        const char* next = jsonify::writers::escape::find_escape( p, end );
+        jsonify::utils::put_bytes( os, p, static_cast< size_t >( next - p ) );
+        if( next == end ) {
+          break;
+        }
+        int n = jsonify::writers::escape::escape_char( static_cast< unsigned char >( *next ), escaped );
+        jsonify::utils::put_bytes( os, escaped, static_cast< size_t >( n ) );
+        p = next + 1;
+      }
+      rapidjson::PutUnsafe( os, '\"' );
+      return true;
+    }
+
+    bool validate_json_;
+  };
+
+} // namespace writers
+} // namespace jsonify
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef JSONIFY_WRITERS_NUMBERS_H
+#define JSONIFY_WRITERS_NUMBERS_H
+
+#include <cmath>
+#include <cstdint>
+
+// Formats doubles as decimal text, producing the same text as rapidjson's
+// Writer::Double() would for the (rounded) value.
+//
+// A double rounded to 'digits' decimal places is m / 10^digits for an integer m.
+// When m has at most 15 significant digits (DBL_DIG) that decimal is the shortest
+// representation of the rounded double, so it can be written straight from m,
+// without dividing by 10^digits and without running Grisu over the result.
+
+#define JSONIFY_FIXED_MAX_DIGITS 15
+#define JSONIFY_FIXED_MAX_MANTISSA 1e15
+#define JSONIFY_NUMBER_BUFFER_SIZE 40
+
+namespace jsonify {
+namespace writers {
+namespace numbers {
+
+  inline double power_of_ten( int digits ) {
+    static const double powers[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    return digits <= 22 ? powers[ digits ] : std::pow( 10.0, digits );
+  }
+
+  // "00" "01" ... "99", so integers are converted two digits at a time
+  inline const char* digit_pairs() {
+    static const char pairs[] =
+      "00010203040506070809"
+      "10111213141516171819"
+      "20212223242526272829"
+      "30313233343536373839"
+      "40414243444546474849"
+      "50515253545556575859"
+      "60616263646566676869"
+      "70717273747576777879"
+      "80818283848586878889"
+      "90919293949596979899";
+    return pairs;
+  }
+
+  // writes 'value' to 'buffer' (which must have room for 11 characters), returning
+  // the length written
+  inline int format_int( int value, char* buffer ) {
+    const char* pairs = digit_pairs();
+    int n = 0;
+    uint32_t u = static_cast< uint32_t >( value );
+    if( value < 0 ) {
+      buffer[ n++ ] = '-';
+      u = ~u + 1;
+    }
+
+    int n_digits = 1;
+    uint32_t v;
+    for( v = u; v >= 10; v /= 10 ) {
+      ++n_digits;
+    }
+
+    char* p = buffer + n + n_digits;
+    while( u >= 100 ) {
+      const char* d = pairs + ( u % 100 ) * 2;
+      u /= 100;
+      *--p = d[1];
+      *--p = d[0];
+    }
+    if( u >= 10 ) {
+      const char* d = pairs + u * 2;
+      *--p = d[1];
+      *--p = d[0];
+    } else {
+      *--p = static_cast< char >( '0' + u );
+    }
+    return n + n_digits;
+  }
+
+  // writes 'value' backwards from 'end', returning the start of the digits
+  inline char* write_digits_backwards( char* end, uint64_t value ) {
+    do {
+      *--end = static_cast< char >( '0' + ( value % 10 ) );
+      value /= 10;
+    } while( value != 0 );
+    return end;
+  }
+
+  // the JSON for a value which is zero after rounding, keeping the sign of -0.0
+  inline int format_zero( double value, char* buffer ) {
+    int n = 0;
+    if( std::signbit( value ) ) {
+      buffer[ n++ ] = '-';
+    }
+    buffer[ n++ ] = '0';
+    buffer[ n++ ] = '.';
+    buffer[ n++ ] = '0';
+    return n;
+  }
+
+  // 'm' is the (rounded) value scaled by 10^digits. Writes the integer part, then
+  // the decimals without trailing zeros, keeping at least one (as in "2.0").
+  // Returns the length written, or 0 if Writer::Double() would have used the
+  // exponent form (i.e. the value is smaller than 1e-6)
+  inline int format_scaled( double m, int digits, char* buffer ) {
+
+    if( m == 0 ) {
+      return format_zero( m, buffer );
+    }
+
+    bool negative = m < 0;
+    uint64_t mantissa = static_cast< uint64_t >( negative ? -m : m );
+
+    char digit_buffer[ JSONIFY_NUMBER_BUFFER_SIZE ];
+    char* end = digit_buffer + JSONIFY_NUMBER_BUFFER_SIZE;
+    char* start = write_digits_backwards( end, mantissa );
+    int n_digits = static_cast< int >( end - start );
+
+    // position of the decimal point relative to the first digit
+    int point = n_digits - digits;
+    if( point <= -6 ) {
+      return 0;
+    }
+
+    // drop trailing zero decimals
+    int n_decimals = digits;
+    while( n_decimals > 0 && end[ -1 ] == '0' ) {
+      --end;
+      --n_decimals;
+    }
+
+    int n = 0;
+    if( negative ) {
+      buffer[ n++ ] = '-';
+    }
+
+    if( point <= 0 ) {
+      buffer[ n++ ] = '0';
+      buffer[ n++ ] = '.';
+      while( point < 0 ) {
+        buffer[ n++ ] = '0';
+        ++point;
+      }
+      while( start < end ) {
+        buffer[ n++ ] = *start++;
+      }
+      return n;
+    }
+
+    while( point-- > 0 ) {
+      buffer[ n++ ] = *start++;
+    }
+    buffer[ n++ ] = '.';
+    if( n_decimals == 0 ) {
+      buffer[ n++ ] = '0';
+    }
+    while( start < end ) {
+      buffer[ n++ ] = *start++;
+    }
+    return n;
+  }
+
+  // 'value' rounded to 'digits' decimal places (digits >= 0). Returns 0 if the
+  // value can't be written exactly this way and should go through Writer::Double()
+  inline int format_fixed( double value, int digits, char* buffer ) {
+    if( digits > JSONIFY_FIXED_MAX_DIGITS ) {
+      return 0;
+    }
+    double m = std::round( value * power_of_ten( digits ) );
+    if( !( std::fabs( m ) < JSONIFY_FIXED_MAX_MANTISSA ) ) {
+      return 0;
+    }
+    return format_scaled( m, digits, buffer );
+  }
+
+  // whole numbers, as "12.0". Returns 0 if 'value' isn't a whole number
+  // which can be written this way
+  inline int format_integral( double value, char* buffer ) {
+    if( !( std::fabs( value ) < JSONIFY_FIXED_MAX_MANTISSA ) || value != std::trunc( value ) ) {
+      return 0;
+    }
+    return format_scaled( value, 0, buffer );
+  }
+
+} // namespace numbers
+} // namespace writers
+} // namespace jsonify
+
+#endif
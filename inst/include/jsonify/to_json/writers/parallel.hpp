@@ -0,0 +1,382 @@
+#ifndef R_JSONIFY_WRITERS_PARALLEL_H
+#define R_JSONIFY_WRITERS_PARALLEL_H
+
+#include <Rcpp.h>
+#include "jsonify/to_json/utils.hpp"
+#include "jsonify/to_json/writers/complex.hpp"
+#include "jsonify/to_json/writers/json_writer.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <algorithm>
+#include <climits>
+#include <exception>
+#include <memory>
+#include <vector>
+
+// Writes the rows of a data.frame (or the rows / columns of a matrix) on several
+// threads. Each thread writes a block of rows into its own buffer, straight from
+// the column data, and the buffers are appended to the output in order, so the
+// result is identical to the single-threaded writer.
+//
+// Nothing in here may touch the R API from a worker thread, so only columns
+// which the column plan can write from raw pointers are supported; anything
+// else falls back to the serial writers. The strings of string columns are
+// read into the plan on the calling thread first (prepare_strings()).
+//
+// An exception mustn't leave an OpenMP region (it would call std::terminate()),
+// so each block's is caught, and the first is rethrown once the region's done.
+
+#define JSONIFY_PARALLEL_BLOCK_ROWS 8192
+
+namespace jsonify {
+namespace writers {
+namespace parallel {
+
+  // no more threads than there are processors (or OpenMP allows) nor, given
+  // the 'n' elements to write, than there are blocks of them
+  inline int available_threads( int threads, R_xlen_t n = -1 ) {
+#ifdef _OPENMP
+    if( threads <= 1 ) {
+      return 1;
+    }
+    threads = std::min( threads, omp_get_num_procs() );
+    threads = std::min( threads, omp_get_thread_limit() );
+    if( n >= 0 ) {
+      R_xlen_t n_blocks = ( n + JSONIFY_PARALLEL_BLOCK_ROWS - 1 ) / JSONIFY_PARALLEL_BLOCK_ROWS;
+      threads = static_cast< int >( std::min< R_xlen_t >( threads, n_blocks ) );
+    }
+    return threads > 1 ? threads : 1;
+#else
+    (void)threads;
+    (void)n;
+    return 1;
+#endif
+  }
+
+  inline bool can_write_column( const jsonify::writers::complex::column_plan& c ) {
+
+    switch( c.kind ) {
+    case jsonify::writers::complex::COL_NUMERIC: {}
+    case jsonify::writers::complex::COL_INTEGER: {}
+    case jsonify::writers::complex::COL_LOGICAL: {}
+    case jsonify::writers::complex::COL_FACTOR: {}
+    case jsonify::writers::complex::COL_DATE: {}
+    case jsonify::writers::complex::COL_POSIXCT: {}
+    case jsonify::writers::complex::COL_STRING: {}
+    case jsonify::writers::complex::COL_MATRIX: {
+      return true;
+    }
+    case jsonify::writers::complex::COL_JSON: {
+      // validating the JSON can stop()
+      return false;
+    }
+    case jsonify::writers::complex::COL_DATA_FRAME: {
+      for( const auto& nested : c.nested ) {
+        if( !can_write_column( nested ) ) {
+          return false;
+        }
+      }
+      return true;
+    }
+    default: {
+      // lists and anything else go through Rcpp
+      return false;
+    }
+    }
+  }
+
+  // reads the strings (CHARSXP pointers and lengths) of the string columns, as
+  // STRING_ELT() can't be used off the main thread - nor can an ALTREP vector's
+  // elements be, which may be made as they're accessed
+  inline void prepare_strings( jsonify::writers::complex::column_plan& c ) {
+    switch( c.kind ) {
+    case jsonify::writers::complex::COL_STRING: {
+      jsonify::writers::bulk::make_string_refs( c.col, c.strings );
+      break;
+    }
+    case jsonify::writers::complex::COL_MATRIX: {
+      if( c.r_type == STRSXP ) {
+        jsonify::writers::bulk::make_string_refs( c.col, c.strings );
+      }
+      break;
+    }
+    case jsonify::writers::complex::COL_DATA_FRAME: {
+      for( auto& nested : c.nested ) {
+        prepare_strings( nested );
+      }
+      break;
+    }
+    default: {}
+    }
+  }
+
+  inline void rethrow_first( const std::vector< std::exception_ptr >& errors, int n_blocks ) {
+    int block;
+    for( block = 0; block < n_blocks; ++block ) {
+      if( errors[ block ] ) {
+        std::rethrow_exception( errors[ block ] );
+      }
+    }
+  }
+
+  // Writes 'n' array elements, using the element writer 'write_element( writer, i )',
+  // 'threads' blocks at a time. Each block is written as its own JSON array,
+  // and the elements (without the block's brackets) are appended to 'os'
+  template< typename OutputStream, typename ElementWriter >
+  inline void write_array(
+      OutputStream& os,
+      R_xlen_t n,
+      int threads,
+      ElementWriter write_element
+  ) {
+
+    R_xlen_t block_size = JSONIFY_PARALLEL_BLOCK_ROWS;
+    R_xlen_t round_start;
+    int block;
+
+    threads = available_threads( threads, n );
+
+    std::unique_ptr< rapidjson::StringBuffer[] > buffers( new rapidjson::StringBuffer[ threads ] );
+    std::vector< std::exception_ptr > errors( threads );
+
+    os.Put('[');
+    for( round_start = 0; round_start < n; round_start += block_size * threads ) {
+
+      R_xlen_t remaining = n - round_start;
+      int n_blocks = static_cast< int >( std::min< R_xlen_t >( threads, ( remaining + block_size - 1 ) / block_size ) );
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( threads ) schedule( static, 1 )
+#endif
+      for( block = 0; block < n_blocks; ++block ) {
+
+        R_xlen_t i;
+        R_xlen_t start = round_start + block * block_size;
+        R_xlen_t end = std::min< R_xlen_t >( start + block_size, n );
+
+        try {
+          buffers[ block ].Clear();
+          jsonify::writers::json_writer< rapidjson::StringBuffer > writer( buffers[ block ] );
+          writer.StartArray();
+          for( i = start; i < end; ++i ) {
+            write_element( writer, i );
+          }
+          writer.EndArray();
+        } catch( ... ) {
+          errors[ block ] = std::current_exception();
+        }
+      }
+      rethrow_first( errors, n_blocks );
+
+      for( block = 0; block < n_blocks; ++block ) {
+        if( round_start > 0 || block > 0 ) {
+          os.Put(',');
+        }
+        // strip the block's '[' and ']'
+        const char* json = buffers[ block ].GetString();
+        jsonify::utils::put_bytes( os, json + 1, buffers[ block ].GetSize() - 2 );
+      }
+    }
+    os.Put(']');
+  }
+
+  // Writes 'n' separate JSON documents, one per element, using the element writer
+  // 'write_element( writer, i )', 'threads' blocks at a time. Each block's documents
+  // are written end-to-end into the block's buffer, and the strings are made from
+  // the buffers on the calling thread. With one thread the element writer may use
+  // the R API (and only then can 'validate_json' stop())
+  template< typename ElementWriter >
+  inline Rcpp::StringVector write_documents(
+      R_xlen_t n,
+      int threads,
+      ElementWriter write_element,
+      bool validate_json = false
+  ) {
+
+    R_xlen_t block_size = JSONIFY_PARALLEL_BLOCK_ROWS;
+    R_xlen_t round_start;
+    int block;
+
+    threads = available_threads( threads, n );
+
+    Rcpp::StringVector res( n );
+    std::unique_ptr< rapidjson::StringBuffer[] > buffers( new rapidjson::StringBuffer[ threads ] );
+    std::vector< std::vector< size_t > > ends( threads );
+    std::vector< std::exception_ptr > errors( threads );
+
+    auto write_block = [&]( int block, R_xlen_t start ) {
+      R_xlen_t i;
+      R_xlen_t end = std::min< R_xlen_t >( start + block_size, n );
+
+      buffers[ block ].Clear();
+      ends[ block ].clear();
+      jsonify::writers::json_writer< rapidjson::StringBuffer > writer( buffers[ block ], validate_json );
+      for( i = start; i < end; ++i ) {
+        writer.Reset( buffers[ block ] );
+        write_element( writer, i );
+        ends[ block ].push_back( buffers[ block ].GetSize() );
+      }
+    };
+
+    for( round_start = 0; round_start < n; round_start += block_size * threads ) {
+
+      R_xlen_t remaining = n - round_start;
+      int n_blocks = static_cast< int >( std::min< R_xlen_t >( threads, ( remaining + block_size - 1 ) / block_size ) );
+
+      if( threads > 1 ) {
+#ifdef _OPENMP
+#pragma omp parallel for num_threads( threads ) schedule( static, 1 )
+#endif
+        for( block = 0; block < n_blocks; ++block ) {
+          try {
+            write_block( block, round_start + block * block_size );
+          } catch( ... ) {
+            errors[ block ] = std::current_exception();
+          }
+        }
+        rethrow_first( errors, n_blocks );
+      } else {
+        write_block( 0, round_start );
+      }
+
+      for( block = 0; block < n_blocks; ++block ) {
+        R_xlen_t i = round_start + block * block_size;
+        const char* json = buffers[ block ].GetString();
+        size_t from = 0;
+        for( const auto& to : ends[ block ] ) {
+          if( to - from > static_cast< size_t >( INT_MAX ) ) {
+            Rcpp::stop("jsonify - the JSON is too long for a character vector");
+          }
+          SET_STRING_ELT( res, i++, Rf_mkCharLenCE( json + from, static_cast< int >( to - from ), CE_UTF8 ) );
+          from = to;
+        }
+        jsonify::stats::count( jsonify::stats::COUNT_BYTES_WRITTEN, from );
+      }
+    }
+    return res;
+  }
+
+  // a row (or with by = "column", a column) of a matrix
+  template< typename Policy >
+  struct matrix_writer {
+    const jsonify::writers::complex::column_plan& mat;
+    int digits;
+
+    template< typename Writer >
+    void operator()( Writer& writer, R_xlen_t i ) const {
+      if( Policy::by_column ) {
+        jsonify::writers::complex::write_matrix_slice< Policy >( writer, mat, i * mat.n_row, mat.n_row, 1, digits );
+      } else {
+        jsonify::writers::complex::write_matrix_slice< Policy >( writer, mat, i, mat.n_col, mat.n_row, digits );
+      }
+    }
+  };
+
+  // the element writers below use the R API, so are only used on one thread
+
+  // a column of a data.frame, as an object keyed by the column's name
+  template< typename Policy >
+  struct column_document_writer {
+    SEXP df;
+    SEXP names;
+    const jsonify::writers::complex::write_options& opts;
+
+    template< typename Writer >
+    void operator()( Writer& writer, R_xlen_t i ) const {
+      SEXP name = STRING_ELT( names, i );
+      writer.StartObject();
+      writer.String( CHAR( name ), static_cast< rapidjson::SizeType >( Rf_length( name ) ) );
+      jsonify::writers::complex::write_value< Policy >( writer, VECTOR_ELT( df, i ), opts, -1, true );
+      writer.EndObject();
+    }
+  };
+
+  // an element of a list, as an object keyed by its name if the list is named
+  template< typename Policy >
+  struct list_document_writer {
+    SEXP lst;
+    SEXP names;
+    const jsonify::writers::complex::write_options& opts;
+
+    template< typename Writer >
+    void operator()( Writer& writer, R_xlen_t i ) const {
+      bool has_names = !Rf_isNull( names );
+      if( has_names ) {
+        SEXP name = STRING_ELT( names, i );
+        writer.StartObject();
+        writer.String( CHAR( name ), static_cast< rapidjson::SizeType >( Rf_length( name ) ) );
+      }
+      jsonify::writers::complex::write_value< Policy >( writer, VECTOR_ELT( lst, i ), opts );
+      if( has_names ) {
+        writer.EndObject();
+      }
+    }
+  };
+
+  // returns false (having written nothing) if 'obj' can't be written in parallel
+  template< typename Policy, typename OutputStream >
+  inline bool write_value(
+      OutputStream& os,
+      SEXP obj,
+      int threads,
+      const jsonify::writers::complex::write_options& opts
+  ) {
+
+    threads = available_threads( threads );
+    if( threads <= 1 ) {
+      return false;
+    }
+
+    if( Rf_inherits( obj, "data.frame" ) ) {
+
+      if( Policy::by_column ) {
+        return false;
+      }
+
+      Rcpp::DataFrame df = Rcpp::as< Rcpp::DataFrame >( obj );
+      R_xlen_t n_rows = df.nrows();
+
+      std::vector< jsonify::writers::complex::column_plan > plan;
+      jsonify::writers::complex::make_column_plan< Policy >( df, opts.datetime, plan );
+
+      for( const auto& c : plan ) {
+        if( !can_write_column( c ) ) {
+          return false;
+        }
+      }
+      for( auto& c : plan ) {
+        prepare_strings( c );
+      }
+
+      jsonify::writers::complex::row_writer< Policy > rw = { plan, opts };
+      write_array( os, n_rows, threads, rw );
+      return true;
+    }
+
+    if( Rf_isMatrix( obj ) ) {
+
+      int r_type = TYPEOF( obj );
+      if( r_type != REALSXP && r_type != INTSXP && r_type != LGLSXP && r_type != STRSXP ) {
+        return false;
+      }
+
+      jsonify::writers::complex::column_plan mat;
+      jsonify::writers::complex::make_matrix_plan( obj, mat );
+      prepare_strings( mat );
+
+      matrix_writer< Policy > mw = { mat, opts.digits };
+      write_array( os, Policy::by_column ? mat.n_col : mat.n_row, threads, mw );
+      return true;
+    }
+
+    return false;
+  }
+
+} // namespace parallel
+} // namespace writers
+} // namespace jsonify
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef R_JSONIFY_WRITERS_POLICY_H
+#define R_JSONIFY_WRITERS_POLICY_H
+
+#include <Rcpp.h>
+#include <string>
+
+// The options which change how values are written, as compile-time constants.
+// They're resolved from the R arguments once per call, by dispatch() in the api,
+// and the writers are instantiated for each combination, so nothing below the
+// api tests them - not per data.frame, per column or per cell.
+//
+// 'digits' and the date-time format are values rather than switches, so they're
+// passed at run-time; the policy only says whether there's rounding at all.
+
+namespace jsonify {
+namespace writers {
+namespace policy {
+
+  template< bool UNBOX, bool ROUND, bool NUMERIC_DATES, bool FACTORS_AS_STRING, bool BY_COLUMN >
+  struct options {
+    static const bool unbox = UNBOX;
+    static const bool round = ROUND;                         // digits >= 0
+    static const bool numeric_dates = NUMERIC_DATES;
+    static const bool factors_as_string = FACTORS_AS_STRING;
+    static const bool by_column = BY_COLUMN;                 // by = "column"
+  };
+
+  inline bool by_column( const std::string& by ) {
+    if( by == "row" ) {
+      return false;
+    }
+    if( by != "column" ) {
+      Rcpp::stop("jsonify - by must be either \"row\" or \"column\"");
+    }
+    return true;
+  }
+
+  // each step resolves one option, and passes it on to the next as a template argument
+
+  template< bool UNBOX, bool ROUND, bool NUMERIC_DATES, bool FACTORS_AS_STRING, typename F >
+  inline void dispatch_by( bool by_column, F& f ) {
+    if( by_column ) {
+      f( options< UNBOX, ROUND, NUMERIC_DATES, FACTORS_AS_STRING, true >() );
+    } else {
+      f( options< UNBOX, ROUND, NUMERIC_DATES, FACTORS_AS_STRING, false >() );
+    }
+  }
+
+  template< bool UNBOX, bool ROUND, bool NUMERIC_DATES, typename F >
+  inline void dispatch_factors( bool factors_as_string, bool by_column, F& f ) {
+    if( factors_as_string ) {
+      dispatch_by< UNBOX, ROUND, NUMERIC_DATES, true >( by_column, f );
+    } else {
+      dispatch_by< UNBOX, ROUND, NUMERIC_DATES, false >( by_column, f );
+    }
+  }
+
+  template< bool UNBOX, bool ROUND, typename F >
+  inline void dispatch_dates( bool numeric_dates, bool factors_as_string, bool by_column, F& f ) {
+    if( numeric_dates ) {
+      dispatch_factors< UNBOX, ROUND, true >( factors_as_string, by_column, f );
+    } else {
+      dispatch_factors< UNBOX, ROUND, false >( factors_as_string, by_column, f );
+    }
+  }
+
+  template< bool UNBOX, typename F >
+  inline void dispatch_round( int digits, bool numeric_dates, bool factors_as_string, bool by_column, F& f ) {
+    if( digits >= 0 ) {
+      dispatch_dates< UNBOX, true >( numeric_dates, factors_as_string, by_column, f );
+    } else {
+      dispatch_dates< UNBOX, false >( numeric_dates, factors_as_string, by_column, f );
+    }
+  }
+
+  // calls 'f( options< unbox, digits >= 0, numeric_dates, factors_as_string, by_column >() )'
+  template< typename F >
+  inline void dispatch( bool unbox, int digits, bool numeric_dates, bool factors_as_string, bool by_column, F& f ) {
+    if( unbox ) {
+      dispatch_round< true >( digits, numeric_dates, factors_as_string, by_column, f );
+    } else {
+      dispatch_round< false >( digits, numeric_dates, factors_as_string, by_column, f );
+    }
+  }
+
+} // namespace policy
+} // namespace writers
+} // namespace jsonify
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef JSONIFY_WRITERS_SCALARS_H
 #define JSONIFY_WRITERS_SCALARS_H
 
+#include "jsonify/to_json/writers/numbers.hpp"
 
 namespace jsonify {
 namespace writers {
@@ -16,15 +17,12 @@ namespace scalars {
   
   template <typename Writer>
   inline void write_value( Writer& writer, int& value ) {
-    if( std::isnan( value ) ) {
-      writer.Null();
-    } else {
-      writer.Int( value );
-    }
+    writer.Int( value );
   }
   
-  template <typename Writer>
-  inline void write_value( Writer& writer, double& value, int& digits ) {
+  // 'ROUND' is digits >= 0, fixed at compile-time for the row writers
+  template < bool ROUND, typename Writer >
+  inline void write_number( Writer& writer, double value, int digits ) {
     
     if(std::isnan( value ) ) {
       writer.Null();
@@ -40,14 +38,35 @@ namespace scalars {
       writer.String( str.c_str() );
     } else {
       
-      if ( digits >= 0 ) {
-        double e = std::pow( 10.0, digits );
+      // rounded and whole numbers are formatted directly; anything else
+      // (e.g. very small or very large) goes through Writer::Double
+      char buffer[ JSONIFY_NUMBER_BUFFER_SIZE ];
+      int n = ROUND 
+        ? jsonify::writers::numbers::format_fixed( value, digits, buffer )
+        : jsonify::writers::numbers::format_integral( value, buffer );
+      
+      if( n > 0 ) {
+        writer.RawValue( buffer, n, rapidjson::kNumberType );
+        return;
+      }
+      
+      if ( ROUND ) {
+        double e = jsonify::writers::numbers::power_of_ten( digits );
         value = round( value * e ) / e;
       }
       writer.Double( value );
     }
   }
   
+  template <typename Writer>
+  inline void write_value( Writer& writer, double value, int digits ) {
+    if( digits >= 0 ) {
+      write_number< true >( writer, value, digits );
+    } else {
+      write_number< false >( writer, value, digits );
+    }
+  }
+  
   template< typename Writer> 
   inline void write_value( Writer& writer, bool& value ) {
     writer.Bool( value );
@@ -3,7 +3,11 @@
 
 #include <Rcpp.h>
 #include "jsonify/to_json/utils.hpp"
+#include "jsonify/to_json/dates/dates.hpp"
 #include "jsonify/to_json/writers/scalars.hpp"
+#include "jsonify/to_json/writers/bulk.hpp"
+#include "jsonify/to_json/writers/factors.hpp"
+#include "jsonify/to_json/writers/policy.hpp"
 
 using namespace rapidjson;
 
@@ -15,15 +19,17 @@ namespace simple {
   // ---------------------------------------------------------------------------
   // vectors
   // ---------------------------------------------------------------------------
-  template <typename Writer>
+  // The vectors are written with the options of a jsonify::writers::policy, 
+  // resolved by the caller. The overloads which take the options at run-time 
+  // (further down) resolve them into a policy for the one vector
+  template< typename Policy, typename Writer >
   inline void write_value(
       Writer& writer, 
-      Rcpp::StringVector sv, 
-      bool unbox
+      Rcpp::StringVector sv
     ) {
     
     R_xlen_t n = sv.size();
-    bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+    bool will_unbox = jsonify::utils::should_unbox( n, Policy::unbox );
     jsonify::utils::start_array( writer, will_unbox );
     R_xlen_t i;
 
@@ -75,43 +81,64 @@ namespace simple {
   }
 #endif
   
-  template< typename Writer>
+  /*
+   * Date and POSIXct vectors, formatted as they're written
+   */
+  template< typename Writer, int RTYPE >
+  inline void write_dates(
+      Writer& writer,
+      Rcpp::Vector< RTYPE >& v,
+      bool unbox,
+      bool is_datetime,
+      const jsonify::dates::datetime_format& datetime
+  ) {
+    
+    R_xlen_t n = v.size();
+    bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+    jsonify::utils::start_array( writer, will_unbox );
+    R_xlen_t i;
+    
+    std::vector< int > offsets;
+    if( is_datetime && datetime.offset ) {
+      jsonify::dates::utc_offsets( v, offsets );
+    }
+    
+    for ( i = 0; i < n; ++i ) {
+      typename Rcpp::traits::storage_type< RTYPE >::type value = v[i];
+      if( is_datetime ) {
+        jsonify::dates::write_datetime( writer, value, datetime, offsets.empty() ? 0 : offsets[ i ] );
+      } else {
+        jsonify::dates::write_date( writer, value );
+      }
+    }
+    jsonify::utils::end_array( writer, will_unbox );
+  }
+  
+  // with numeric_dates the class isn't looked at
+  template< typename Policy, typename Writer >
   inline void write_value(
       Writer& writer, 
       Rcpp::NumericVector nv, 
-      bool unbox, 
       int digits, 
-      bool numeric_dates
+      const jsonify::dates::datetime_format& datetime
     ) {
-
-    Rcpp::CharacterVector cls = jsonify::utils::getRClass( nv );
     
-    if( !numeric_dates && jsonify::dates::is_in( "Date", cls ) ) {
+    if( !Policy::numeric_dates && Rf_inherits( nv, "Date" ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::date_to_string( nv );
-      write_value( writer, sv, unbox );
+      write_dates( writer, nv, Policy::unbox, false, datetime );
       
-    } else if ( !numeric_dates && jsonify::dates::is_in( "POSIXt", cls ) ) {
+    } else if ( !Policy::numeric_dates && Rf_inherits( nv, "POSIXt" ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::posixct_to_string( nv );
-      write_value( writer, sv, unbox );
+      write_dates( writer, nv, Policy::unbox, true, datetime );
       
     } else {
     
       R_xlen_t n = nv.size();
-      bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+      bool will_unbox = jsonify::utils::should_unbox( n, Policy::unbox );
       
       jsonify::utils::start_array( writer, will_unbox );
-      R_xlen_t i;
-
-      for ( i = 0; i < n; ++i ) {
-        if( Rcpp::NumericVector::is_na( nv[i] ) ) {
-          writer.Null();
-        } else {
-          jsonify::writers::scalars::write_value( writer, nv[i], digits );
-        }
-      }
-    jsonify::utils::end_array( writer, will_unbox );
+      jsonify::writers::bulk::write_numbers< Policy::round >( writer, REAL( nv ), n, 1, digits );
+      jsonify::utils::end_array( writer, will_unbox );
     }
   }
   
@@ -131,13 +158,11 @@ namespace simple {
     
     if( !numeric_dates && jsonify::dates::is_in( "Date", cls ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::date_to_string( nv );
-      write_value( writer, sv, row );
+      jsonify::dates::write_date( writer, nv[ row ] );
       
     } else if ( !numeric_dates && jsonify::dates::is_in( "POSIXt", cls ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::posixct_to_string( nv );
-      write_value( writer, sv, row );
+      jsonify::dates::write_datetime( writer, nv[ row ] );
       
     } else {
       if ( Rcpp::NumericVector::is_na( nv[ row ] ) ) {
@@ -166,13 +191,11 @@ namespace simple {
     
     if( !numeric_dates && jsonify::dates::is_in( "Date", cls ) ) {
 
-      Rcpp::StringVector sv = jsonify::dates::date_to_string( nv );
-      write_value( writer, sv, row );
+      jsonify::dates::write_date( writer, nv[ row ] );
       
     } else if ( !numeric_dates && jsonify::dates::is_in( "POSIXt", cls ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::posixct_to_string( nv );
-      write_value( writer, sv, row );
+      jsonify::dates::write_datetime( writer, nv[ row ] );
       
     } else {
       if ( Rcpp::NumericVector::is_na( nv[ row ] ) ) {
@@ -185,28 +208,22 @@ namespace simple {
   }
 #endif
   
-  template < typename Writer >
+  template< typename Policy, typename Writer >
   inline void write_value(
       Writer& writer, 
       Rcpp::IntegerVector iv, 
-      bool unbox, 
-      bool numeric_dates,
-      bool factors_as_string
+      const jsonify::dates::datetime_format& datetime
     ) {
     
-    Rcpp::CharacterVector cls = jsonify::utils::getRClass( iv );
+    if( !Policy::numeric_dates && Rf_inherits( iv, "Date" ) ) {
 
-    if( !numeric_dates && jsonify::dates::is_in( "Date", cls ) ) {
-
-      Rcpp::StringVector sv = jsonify::dates::date_to_string( iv );
-      write_value( writer, sv, unbox );
+      write_dates( writer, iv, Policy::unbox, false, datetime );
       
-    } else if ( !numeric_dates && jsonify::dates::is_in( "POSIXt", cls ) ) {
+    } else if ( !Policy::numeric_dates && Rf_inherits( iv, "POSIXt" ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::posixct_to_string( iv );
-      write_value( writer, sv, unbox );
+      write_dates( writer, iv, Policy::unbox, true, datetime );
       
-    } else if ( factors_as_string && Rf_isFactor( iv ) ) {
+    } else if ( Policy::factors_as_string && Rf_isFactor( iv ) ) {
       
       Rcpp::CharacterVector lvls = iv.attr( "levels" );
       if (lvls.length() == 0 && iv.length() == 0 ) {
@@ -219,25 +236,26 @@ namespace simple {
         R_xlen_t ele = 0;
         write_value( writer, s, ele );
       } else {
-        Rcpp::StringVector str = Rcpp::as< Rcpp::StringVector >( iv );
-        write_value( writer, str, unbox );
-        //write_value( writer, lvls, unbox );
+        // each level is escaped once, then written by its code
+        jsonify::writers::factors::level_table table( lvls );
+        R_xlen_t n = iv.size();
+        bool will_unbox = jsonify::utils::should_unbox( n, Policy::unbox );
+        jsonify::utils::start_array( writer, will_unbox );
+        const int* codes = INTEGER( iv );
+        R_xlen_t i;
+        
+        for( i = 0; i < n; ++i ) {
+          table.write( writer, codes[ i ] );
+        }
+        jsonify::utils::end_array( writer, will_unbox );
       }
       
     } else {
     
       R_xlen_t n = iv.size();
-      bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+      bool will_unbox = jsonify::utils::should_unbox( n, Policy::unbox );
       jsonify::utils::start_array( writer, will_unbox );
-      R_xlen_t i;
-
-      for ( i = 0; i < n; ++i ) {
-        if( Rcpp::IntegerVector::is_na( iv[i] ) ) {
-          writer.Null();
-        } else {
-          jsonify::writers::scalars::write_value( writer, iv[i] );
-        }
-      }
+      jsonify::writers::bulk::write_integers( writer, INTEGER( iv ), n );
       jsonify::utils::end_array( writer, will_unbox );
     }
   }
@@ -259,12 +277,10 @@ namespace simple {
     
     if( !numeric_dates && jsonify::dates::is_in( "Date", cls ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::date_to_string( iv );
-      write_value( writer, sv, row );
+      jsonify::dates::write_date( writer, iv[ row ] );
     } else if ( !numeric_dates && jsonify::dates::is_in( "POSIXt", cls ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::posixct_to_string( iv );
-      write_value( writer, sv, row );
+      jsonify::dates::write_datetime( writer, iv[ row ] );
       
     } else if ( factors_as_string && Rf_isFactor( iv ) ) {
       
@@ -280,8 +296,7 @@ namespace simple {
         int ele = 0;
         write_value( writer, s, ele );
       } else {
-        Rcpp::StringVector str = Rcpp::as< Rcpp::StringVector >( iv );
-        write_value( writer, str, row );
+        jsonify::writers::factors::write_level( writer, lvls, iv[ row ] );
       }
       
     } else {
@@ -312,12 +327,10 @@ namespace simple {
     
     if( !numeric_dates && jsonify::dates::is_in( "Date", cls ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::date_to_string( iv );
-      write_value( writer, sv, row );
+      jsonify::dates::write_date( writer, iv[ row ] );
     } else if ( !numeric_dates && jsonify::dates::is_in( "POSIXt", cls ) ) {
       
-      Rcpp::StringVector sv = jsonify::dates::posixct_to_string( iv );
-      write_value( writer, sv, row );
+      jsonify::dates::write_datetime( writer, iv[ row ] );
       
     } else if ( factors_as_string && Rf_isFactor( iv ) ) {
       
@@ -333,8 +346,7 @@ namespace simple {
         R_xlen_t ele = 0;
         write_value( writer, s, ele );
       } else {
-        Rcpp::StringVector str = Rcpp::as< Rcpp::StringVector >( iv );
-        write_value( writer, str, row );
+        jsonify::writers::factors::write_level( writer, lvls, iv[ row ] );
       }
       
     } else {
@@ -349,71 +361,16 @@ namespace simple {
   }
 #endif
   
-  template< typename Writer >
-  inline void write_value(
-      Writer& writer,
-      Rcpp::NumericVector nv,
-      bool unbox,
-      int digits
-  ) {
-    R_xlen_t n = nv.size();
-    bool will_unbox = jsonify::utils::should_unbox( n, unbox );
-    jsonify::utils::start_array( writer, will_unbox );
-    R_xlen_t i;
-
-    for ( i = 0; i < n; ++i ) {
-      if (Rcpp::NumericVector::is_na( nv[i] ) ) {
-        writer.Null();
-      } else {
-        double nn = nv[i];             // required for logical vectors
-        jsonify::writers::scalars::write_value( writer, nn, digits );
-      }
-    }
-    jsonify::utils::end_array( writer, will_unbox );
-  }
-  
-  template< typename Writer >
-  inline void write_value(
-    Writer& writer,
-    Rcpp::IntegerVector iv,
-    bool unbox
-  ) {
-    R_xlen_t n = iv.size();
-    bool will_unbox = jsonify::utils::should_unbox( n, unbox );
-    jsonify::utils::start_array( writer, will_unbox );
-    R_xlen_t i;
-    
-    for ( i = 0; i < n; ++i ) {
-      if (Rcpp::IntegerVector::is_na( iv[i] ) ) {
-        writer.Null();
-      } else {
-        int ii = iv[i];             // required for logical vectors
-        jsonify::writers::scalars::write_value( writer, ii );
-      }
-    }
-    jsonify::utils::end_array( writer, will_unbox );
-  }
-  
-  template <typename Writer>
+  template< typename Policy, typename Writer >
   inline void write_value(
       Writer& writer, 
-      Rcpp::LogicalVector lv, 
-      bool unbox
+      Rcpp::LogicalVector lv
     ) {
     
     R_xlen_t n = lv.size();
-    bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+    bool will_unbox = jsonify::utils::should_unbox( n, Policy::unbox );
     jsonify::utils::start_array( writer, will_unbox );
-    R_xlen_t i;
-
-    for ( i = 0; i < n; ++i ) {
-      if (Rcpp::LogicalVector::is_na( lv[i] ) ) {
-        writer.Null();
-      } else {
-        bool l = lv[i];             // required for logical vectors
-        jsonify::writers::scalars::write_value( writer, l );
-      }
-    }
+    jsonify::writers::bulk::write_logicals( writer, LOGICAL( lv ), n );
     jsonify::utils::end_array( writer, will_unbox );
   }
   
@@ -448,35 +405,33 @@ namespace simple {
   }
 #endif
   
-  template < typename Writer >
+  template< typename Policy, typename Writer >
   inline void write_value(
       Writer& writer, 
       SEXP sexp, 
-      bool unbox, 
       int digits, 
-      bool numeric_dates,
-      bool factors_as_string
+      const jsonify::dates::datetime_format& datetime
     ) {
     
     switch( TYPEOF( sexp ) ) {
     case REALSXP: {
       Rcpp::NumericVector nv = Rcpp::as< Rcpp::NumericVector >( sexp );
-      write_value( writer, nv, unbox, digits, numeric_dates );
+      write_value< Policy >( writer, nv, digits, datetime );
       break;
     }
     case INTSXP: {
       Rcpp::IntegerVector iv = Rcpp::as< Rcpp::IntegerVector >( sexp );
-      write_value( writer, iv, unbox, numeric_dates, factors_as_string );
+      write_value< Policy >( writer, iv, datetime );
       break;
     }
     case LGLSXP: {
       Rcpp::LogicalVector lv = Rcpp::as< Rcpp::LogicalVector >( sexp );
-      write_value( writer, lv, unbox );
+      write_value< Policy >( writer, lv );
       break;
     }
     default: {
       Rcpp::StringVector sv = Rcpp::as< Rcpp::StringVector >( sexp );
-      write_value( writer, sv, unbox );
+      write_value< Policy >( writer, sv );
       break;
     }
     // default: {
@@ -485,10 +440,229 @@ namespace simple {
     }
   }
   
+  // a vector, with its options resolved into a policy
+  template< typename Writer >
+  struct vector_writer {
+    Writer& writer;
+    SEXP sexp;
+    int digits;
+    const jsonify::dates::datetime_format& datetime;
+    
+    template< typename Policy >
+    void operator()( Policy ) {
+      write_value< Policy >( writer, sexp, digits, datetime );
+    }
+  };
+  
+  template< typename Writer >
+  inline void write_vector(
+      Writer& writer,
+      SEXP sexp,
+      bool unbox,
+      int digits,
+      bool numeric_dates,
+      bool factors_as_string,
+      const jsonify::dates::datetime_format& datetime
+  ) {
+    vector_writer< Writer > vw = { writer, sexp, digits, datetime };
+    jsonify::writers::policy::dispatch( unbox, digits, numeric_dates, factors_as_string, false, vw );
+  }
+  
+  // the vector writers with their options at run-time, for writing a single 
+  // vector. jsonify's own writers resolve the policy once, at the top
+  
+  template < typename Writer >
+  inline void write_value(
+      Writer& writer, 
+      SEXP sexp, 
+      bool unbox, 
+      int digits, 
+      bool numeric_dates,
+      bool factors_as_string,
+      const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+    ) {
+    write_vector( writer, sexp, unbox, digits, numeric_dates, factors_as_string, datetime );
+  }
+  
+  template < typename Writer >
+  inline void write_value(
+      Writer& writer, 
+      Rcpp::StringVector sv, 
+      bool unbox
+    ) {
+    write_vector( writer, sv, unbox, -1, true, true, jsonify::dates::datetime_format() );
+  }
+  
+  template< typename Writer>
+  inline void write_value(
+      Writer& writer, 
+      Rcpp::NumericVector nv, 
+      bool unbox, 
+      int digits, 
+      bool numeric_dates,
+      const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+    ) {
+    write_vector( writer, nv, unbox, digits, numeric_dates, true, datetime );
+  }
+  
+  template < typename Writer >
+  inline void write_value(
+      Writer& writer, 
+      Rcpp::IntegerVector iv, 
+      bool unbox, 
+      bool numeric_dates,
+      bool factors_as_string,
+      const jsonify::dates::datetime_format& datetime = jsonify::dates::datetime_format()
+    ) {
+    write_vector( writer, iv, unbox, -1, numeric_dates, factors_as_string, datetime );
+  }
+  
+  // numbers, without looking at their class
+  template< typename Writer >
+  inline void write_value(
+      Writer& writer,
+      Rcpp::NumericVector nv,
+      bool unbox,
+      int digits
+  ) {
+    write_vector( writer, nv, unbox, digits, true, true, jsonify::dates::datetime_format() );
+  }
+  
+  template< typename Writer >
+  inline void write_value(
+    Writer& writer,
+    Rcpp::IntegerVector iv,
+    bool unbox
+  ) {
+    write_vector( writer, iv, unbox, -1, true, false, jsonify::dates::datetime_format() );
+  }
+  
+  template <typename Writer>
+  inline void write_value(
+      Writer& writer, 
+      Rcpp::LogicalVector lv, 
+      bool unbox
+    ) {
+    write_vector( writer, lv, unbox, -1, true, true, jsonify::dates::datetime_format() );
+  }
+  
 
   // ---------------------------------------------------------------------------
   // matrix values
   // ---------------------------------------------------------------------------
+  // Rows and columns are written straight from the matrix's column-major data, 
+  // stepping through it by 'stride' (n_row for a row, 1 for a column), rather 
+  // than being copied into a new vector first
+  template < typename Writer >
+  inline void write_matrix_slice(
+      Writer& writer,
+      SEXP mat,
+      R_xlen_t start,
+      R_xlen_t n,
+      R_xlen_t stride,
+      bool unbox = false,
+      int digits = -1
+  ) {
+    
+    bool will_unbox = jsonify::utils::should_unbox( n, unbox );
+    jsonify::utils::start_array( writer, will_unbox );
+    
+    switch( TYPEOF( mat ) ) {
+    case REALSXP: {
+      jsonify::writers::bulk::write_doubles( writer, REAL( mat ) + start, n, stride, digits );
+      break;
+    }
+    case INTSXP: {
+      jsonify::writers::bulk::write_integers( writer, INTEGER( mat ) + start, n, stride );
+      break;
+    }
+    case LGLSXP: {
+      jsonify::writers::bulk::write_logicals( writer, LOGICAL( mat ) + start, n, stride );
+      break;
+    }
+    default: {
+      jsonify::writers::bulk::write_strings( writer, mat, start, n, stride );
+    }
+    }
+    jsonify::utils::end_array( writer, will_unbox );
+  }
+  
+  template < typename Writer >
+  inline void write_matrix_row(
+      Writer& writer,
+      SEXP mat,
+      R_xlen_t row,
+      bool unbox = false,
+      int digits = -1
+  ) {
+    write_matrix_slice( writer, mat, row, Rf_ncols( mat ), Rf_nrows( mat ), unbox, digits );
+  }
+  
+  template < typename Writer >
+  inline void write_matrix_column(
+      Writer& writer,
+      SEXP mat,
+      R_xlen_t col,
+      bool unbox = false,
+      int digits = -1
+  ) {
+    R_xlen_t n_row = Rf_nrows( mat );
+    write_matrix_slice( writer, mat, col * n_row, n_row, 1, unbox, digits );
+  }
+  
+  // the whole matrix, as an array of its rows (or columns)
+  template< typename Policy, typename Writer >
+  inline void write_matrix(
+      Writer& writer,
+      SEXP mat,
+      int digits
+  ) {
+    
+    bool will_unbox = false;
+    jsonify::utils::start_array( writer, will_unbox );
+    R_xlen_t i, n;
+    
+    if ( Policy::by_column ) {
+      n = Rf_ncols( mat );
+      for( i = 0; i < n; ++i ) {
+        write_matrix_column( writer, mat, i, Policy::unbox, digits );
+      }
+    } else {
+      n = Rf_nrows( mat );
+      for ( i = 0; i < n; ++i ) {
+        write_matrix_row( writer, mat, i, Policy::unbox, digits );
+      }
+    }
+    jsonify::utils::end_array( writer, will_unbox );
+  }
+  
+  template < typename Writer >
+  inline void write_matrix(
+      Writer& writer,
+      SEXP mat,
+      bool unbox = false,
+      int digits = -1,
+      const std::string& by = "row"
+  ) {
+    
+    bool will_unbox = false;
+    jsonify::utils::start_array( writer, will_unbox );
+    R_xlen_t i, n;
+    
+    if ( by == "row" ) {
+      n = Rf_nrows( mat );
+      for ( i = 0; i < n; ++i ) {
+        write_matrix_row( writer, mat, i, unbox, digits );
+      }
+    } else { // by == "column"
+      n = Rf_ncols( mat );
+      for( i = 0; i < n; ++i ) {
+        write_matrix_column( writer, mat, i, unbox, digits );
+      }
+    }
+    jsonify::utils::end_array( writer, will_unbox );
+  }
+  
 #ifdef LONG_VECTOR_SUPPORT
   
   template < typename Writer >
@@ -498,10 +672,7 @@ namespace simple {
       R_xlen_t& row, 
       bool unbox = false
     ) {
-    bool numeric_dates = true;
-    bool factors_as_string = true;
-    Rcpp::IntegerVector this_row = mat(row, Rcpp::_);
-    write_value( writer, this_row, unbox, numeric_dates, factors_as_string );  // true, true : numeric_dates, factors_as_string
+    write_matrix_row( writer, mat, row, unbox );
   }
   
 #endif
@@ -513,9 +684,7 @@ namespace simple {
       int& row, 
       bool unbox = false
   ) {
-    
-    Rcpp::IntegerVector this_row = mat(row, Rcpp::_);
-    write_value( writer, this_row, unbox, true, true );  // true, true : numeric_dates, factors_as_string
+    write_matrix_row( writer, mat, row, unbox );
   }
   
   template < typename Writer >
@@ -523,29 +692,9 @@ namespace simple {
       Writer& writer, 
       Rcpp::IntegerMatrix mat, 
       bool unbox = false,
-      std::string by = "row"
+      const std::string& by = "row"
   ) {
-    
-    bool will_unbox = false;
-    jsonify::utils::start_array( writer, will_unbox );
-    R_xlen_t n;
-    R_xlen_t i;
-    bool numeric_dates = true;
-    bool factors_as_string = true;
-    if ( by == "row" ) {
-      n = mat.nrow();
-      for ( i = 0; i < n; ++i ) {
-        Rcpp::IntegerVector this_row = mat(i, Rcpp::_);
-        write_value( writer, this_row, unbox, numeric_dates, factors_as_string );  // true, true : numeric_dates, factors_as_string
-      }
-    } else { // by == "column"
-      n = mat.ncol();
-      for( i = 0; i < n; ++i ) {
-        Rcpp::IntegerVector this_col = mat( Rcpp::_, i );
-        write_value( writer, this_col, unbox, numeric_dates, factors_as_string ); // true, true : numeric_dates, factors_as_string
-      }
-    }
-    jsonify::utils::end_array( writer, will_unbox );
+    write_matrix( writer, mat, unbox, -1, by );
   }
   
 #ifdef LONG_VECTOR_SUPPORT
@@ -559,10 +708,7 @@ namespace simple {
       int digits = -1,
       bool numeric_dates = true
     ) {
-    // unbox, digits, dates
-    // row, digits, dates
-    Rcpp::NumericVector this_row = mat(row, Rcpp::_);
-    write_value( writer, this_row, unbox, digits, numeric_dates );
+    write_matrix_row( writer, mat, row, unbox, digits );
   }
 #endif
   
@@ -573,10 +719,7 @@ namespace simple {
       int& row, 
       bool unbox = false
   ) {
-    
-    Rcpp::NumericVector this_row = mat(row, Rcpp::_);
-    write_value( writer, this_row, unbox, true, true );  // true, true : numeric_dates, factors_as_string
-    
+    write_matrix_row( writer, mat, row, unbox );
   }
   
   template < typename Writer >
@@ -585,30 +728,9 @@ namespace simple {
       Rcpp::NumericMatrix mat, 
       bool unbox = false, 
       int digits = -1, 
-      std::string by = "row"
+      const std::string& by = "row"
   ) {
-    
-    bool will_unbox = false;
-    jsonify::utils::start_array( writer, will_unbox );
-    
-    R_xlen_t n;
-    R_xlen_t i;
-    bool numeric_dates = true;
-    
-    if ( by == "row" ) {
-      n = mat.nrow();
-      for ( i = 0; i < n; ++i ) {
-        Rcpp::NumericVector this_row = mat(i, Rcpp::_);
-        write_value( writer, this_row, unbox, digits, numeric_dates );  // true : numeric dates
-      }
-    } else { // by == "column"
-      n = mat.ncol();
-      for( i = 0; i < n; ++i ) {
-        Rcpp::NumericVector this_col = mat( Rcpp::_, i );
-        write_value( writer, this_col, unbox, digits, numeric_dates );  // true : numeric dates
-      }
-    }
-    jsonify::utils::end_array( writer, will_unbox );
+    write_matrix( writer, mat, unbox, digits, by );
   }
 
 #ifdef LONG_VECTOR_SUPPORT
@@ -619,9 +741,7 @@ namespace simple {
       R_xlen_t& row, 
       bool unbox = false
     ) {
-
-    Rcpp::StringVector this_row = mat(row, Rcpp::_);
-    write_value( writer, this_row, unbox );
+    write_matrix_row( writer, mat, row, unbox );
   }
 #endif
   
@@ -632,9 +752,7 @@ namespace simple {
       int& row, 
       bool unbox = false
   ) {
-    
-    Rcpp::StringVector this_row = mat(row, Rcpp::_);
-    write_value( writer, this_row, unbox );
+    write_matrix_row( writer, mat, row, unbox );
   }
   
   template < typename Writer >
@@ -642,27 +760,9 @@ namespace simple {
       Writer& writer, 
       Rcpp::CharacterMatrix mat, 
       bool unbox = false,
-      std::string by = "row"
+      const std::string& by = "row"
   ) {
-    
-    bool will_unbox = false;
-    jsonify::utils::start_array( writer, will_unbox );
-    R_xlen_t i, n;
-
-    if( by == "row" ) {
-      n = mat.nrow();
-      for ( i = 0; i < n; ++i ) {
-        Rcpp::StringVector this_row = mat( i, Rcpp::_ );
-        write_value( writer, this_row, unbox );
-      }
-    } else { // by == column
-      n = mat.ncol();
-      for ( i = 0; i < n; ++i ) {
-        Rcpp::StringVector this_col = mat( Rcpp::_, i );
-        write_value( writer, this_col, unbox );
-      }
-    }
-    jsonify::utils::end_array( writer, will_unbox );
+    write_matrix( writer, mat, unbox, -1, by );
   }
   
 #ifdef LONG_VECTOR_SUPPORT
@@ -674,9 +774,7 @@ namespace simple {
       R_xlen_t& row, 
       bool unbox = false
     ) {
-    
-    Rcpp::LogicalVector this_row = mat( row, Rcpp::_ );
-    write_value( writer, this_row, unbox );
+    write_matrix_row( writer, mat, row, unbox );
   }
 #endif
   
@@ -687,9 +785,7 @@ namespace simple {
       int& row, 
       bool unbox = false
   ) {
-    
-    Rcpp::LogicalVector this_row = mat(row, Rcpp::_);
-    write_value( writer, this_row, unbox );
+    write_matrix_row( writer, mat, row, unbox );
   }
   
   
@@ -698,29 +794,9 @@ namespace simple {
       Writer& writer, 
       Rcpp::LogicalMatrix mat, 
       bool unbox = false, 
-      std::string by = "row"
+      const std::string& by = "row"
   ) {
-    
-    bool will_unbox = false;
-    jsonify::utils::start_array( writer, will_unbox );
-    R_xlen_t i, n;
-
-    if( by == "row" ) {
-      n = mat.nrow();
-      
-      for ( i = 0; i < n; ++i ) {
-        Rcpp::LogicalVector this_row = mat(i, Rcpp::_);
-        write_value( writer, this_row, unbox );
-      }
-    } else { // by == "column;
-      n = mat.ncol();
-      
-      for( i = 0; i < n; ++i ) {
-        Rcpp::LogicalVector this_col = mat( Rcpp::_, i );
-        write_value( writer, this_col, unbox);
-      }
-    }
-    jsonify::utils::end_array( writer, will_unbox );
+    write_matrix( writer, mat, unbox, -1, by );
   }
   
 #ifdef LONG_VECTOR_SUPPORT
@@ -3,6 +3,8 @@
 
 #include <Rcpp.h>
 #include "rapidjson/document.h"
+#include "rapidjson/reader.h"
+#include "rapidjson/memorystream.h"
 
 namespace jsonify {
 namespace validate {
@@ -21,6 +23,15 @@ namespace validate {
     return validate_json( doc, json );
   }
 
+  // parses 'length' bytes of 'json' without building a document, so nothing is
+  // allocated but the parser's own stack
+  inline bool validate_json( const char* json, size_t length ) {
+    rapidjson::Reader reader;
+    rapidjson::BaseReaderHandler<> handler;
+    rapidjson::MemoryStream ms( json, length );
+    return !reader.Parse( ms, handler ).IsError();
+  }
+
 } // namespace validate
 } // namespace jsonify
 
@@ -6,15 +6,34 @@
 using namespace Rcpp;
 
 // rcpp_from_json
-SEXP rcpp_from_json(const char * json, bool& simplify, bool& fill_na);
-RcppExport SEXP _jsonify_rcpp_from_json(SEXP jsonSEXP, SEXP simplifySEXP, SEXP fill_naSEXP) {
+SEXP rcpp_from_json(const char * json, bool& simplify, bool& fill_na, bool sax, SEXP schema, SEXP select);
+RcppExport SEXP _jsonify_rcpp_from_json(SEXP jsonSEXP, SEXP simplifySEXP, SEXP fill_naSEXP, SEXP saxSEXP, SEXP schemaSEXP, SEXP selectSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< const char * >::type json(jsonSEXP);
     Rcpp::traits::input_parameter< bool& >::type simplify(simplifySEXP);
     Rcpp::traits::input_parameter< bool& >::type fill_na(fill_naSEXP);
-    rcpp_result_gen = Rcpp::wrap(rcpp_from_json(json, simplify, fill_na));
+    Rcpp::traits::input_parameter< bool >::type sax(saxSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type schema(schemaSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type select(selectSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_from_json(json, simplify, fill_na, sax, schema, select));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_from_json_raw
+SEXP rcpp_from_json_raw(Rcpp::RawVector json, bool& simplify, bool& fill_na, bool sax, SEXP schema, SEXP select);
+RcppExport SEXP _jsonify_rcpp_from_json_raw(SEXP jsonSEXP, SEXP simplifySEXP, SEXP fill_naSEXP, SEXP saxSEXP, SEXP schemaSEXP, SEXP selectSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< Rcpp::RawVector >::type json(jsonSEXP);
+    Rcpp::traits::input_parameter< bool& >::type simplify(simplifySEXP);
+    Rcpp::traits::input_parameter< bool& >::type fill_na(fill_naSEXP);
+    Rcpp::traits::input_parameter< bool >::type sax(saxSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type schema(schemaSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type select(selectSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_from_json_raw(json, simplify, fill_na, sax, schema, select));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -99,8 +118,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // rcpp_read_json_file
-SEXP rcpp_read_json_file(const char* file, const char* mode, bool& simplify, bool& fill_na, int buffer_size);
-RcppExport SEXP _jsonify_rcpp_read_json_file(SEXP fileSEXP, SEXP modeSEXP, SEXP simplifySEXP, SEXP fill_naSEXP, SEXP buffer_sizeSEXP) {
+SEXP rcpp_read_json_file(const char* file, const char* mode, bool& simplify, bool& fill_na, bool sax, SEXP schema, SEXP select);
+RcppExport SEXP _jsonify_rcpp_read_json_file(SEXP fileSEXP, SEXP modeSEXP, SEXP simplifySEXP, SEXP fill_naSEXP, SEXP saxSEXP, SEXP schemaSEXP, SEXP selectSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -108,8 +127,10 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const char* >::type mode(modeSEXP);
     Rcpp::traits::input_parameter< bool& >::type simplify(simplifySEXP);
     Rcpp::traits::input_parameter< bool& >::type fill_na(fill_naSEXP);
-    Rcpp::traits::input_parameter< int >::type buffer_size(buffer_sizeSEXP);
-    rcpp_result_gen = Rcpp::wrap(rcpp_read_json_file(file, mode, simplify, fill_na, buffer_size));
+    Rcpp::traits::input_parameter< bool >::type sax(saxSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type schema(schemaSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type select(selectSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_read_json_file(file, mode, simplify, fill_na, sax, schema, select));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -127,6 +148,28 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// rcpp_stats_enable
+bool rcpp_stats_enable(bool enable);
+RcppExport SEXP _jsonify_rcpp_stats_enable(SEXP enableSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< bool >::type enable(enableSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_stats_enable(enable));
+    return rcpp_result_gen;
+END_RCPP
+}
+// rcpp_stats
+Rcpp::List rcpp_stats(bool reset);
+RcppExport SEXP _jsonify_rcpp_stats(SEXP resetSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< bool >::type reset(resetSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_stats(reset));
+    return rcpp_result_gen;
+END_RCPP
+}
 // source_tests
 void source_tests();
 RcppExport SEXP _jsonify_source_tests() {
@@ -137,8 +180,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // rcpp_to_json
-Rcpp::StringVector rcpp_to_json(SEXP lst, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by);
-RcppExport SEXP _jsonify_rcpp_to_json(SEXP lstSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP) {
+SEXP rcpp_to_json(SEXP lst, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by, int threads, std::string output, int chunk_size, bool validate_json, int datetime_digits, bool datetime_offset);
+RcppExport SEXP _jsonify_rcpp_to_json(SEXP lstSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP, SEXP threadsSEXP, SEXP outputSEXP, SEXP chunk_sizeSEXP, SEXP validate_jsonSEXP, SEXP datetime_digitsSEXP, SEXP datetime_offsetSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -148,13 +191,42 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type numeric_dates(numeric_datesSEXP);
     Rcpp::traits::input_parameter< bool >::type factors_as_string(factors_as_stringSEXP);
     Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
-    rcpp_result_gen = Rcpp::wrap(rcpp_to_json(lst, unbox, digits, numeric_dates, factors_as_string, by));
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type output(outputSEXP);
+    Rcpp::traits::input_parameter< int >::type chunk_size(chunk_sizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type validate_json(validate_jsonSEXP);
+    Rcpp::traits::input_parameter< int >::type datetime_digits(datetime_digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type datetime_offset(datetime_offsetSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_to_json(lst, unbox, digits, numeric_dates, factors_as_string, by, threads, output, chunk_size, validate_json, datetime_digits, datetime_offset));
     return rcpp_result_gen;
 END_RCPP
 }
+// rcpp_to_json_file
+void rcpp_to_json_file(SEXP lst, const char* file, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by, int threads, int buffer_size, std::string compress, int compression_level, bool validate_json, int datetime_digits, bool datetime_offset);
+RcppExport SEXP _jsonify_rcpp_to_json_file(SEXP lstSEXP, SEXP fileSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP, SEXP threadsSEXP, SEXP buffer_sizeSEXP, SEXP compressSEXP, SEXP compression_levelSEXP, SEXP validate_jsonSEXP, SEXP datetime_digitsSEXP, SEXP datetime_offsetSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type lst(lstSEXP);
+    Rcpp::traits::input_parameter< const char* >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< bool >::type unbox(unboxSEXP);
+    Rcpp::traits::input_parameter< int >::type digits(digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type numeric_dates(numeric_datesSEXP);
+    Rcpp::traits::input_parameter< bool >::type factors_as_string(factors_as_stringSEXP);
+    Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type buffer_size(buffer_sizeSEXP);
+    Rcpp::traits::input_parameter< std::string >::type compress(compressSEXP);
+    Rcpp::traits::input_parameter< int >::type compression_level(compression_levelSEXP);
+    Rcpp::traits::input_parameter< bool >::type validate_json(validate_jsonSEXP);
+    Rcpp::traits::input_parameter< int >::type datetime_digits(datetime_digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type datetime_offset(datetime_offsetSEXP);
+    rcpp_to_json_file(lst, file, unbox, digits, numeric_dates, factors_as_string, by, threads, buffer_size, compress, compression_level, validate_json, datetime_digits, datetime_offset);
+    return R_NilValue;
+END_RCPP
+}
 // rcpp_to_ndjson
-Rcpp::StringVector rcpp_to_ndjson(SEXP lst, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by);
-RcppExport SEXP _jsonify_rcpp_to_ndjson(SEXP lstSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP) {
+SEXP rcpp_to_ndjson(SEXP lst, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by, int threads, std::string output, int chunk_size, bool validate_json, int datetime_digits, bool datetime_offset);
+RcppExport SEXP _jsonify_rcpp_to_ndjson(SEXP lstSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP, SEXP threadsSEXP, SEXP outputSEXP, SEXP chunk_sizeSEXP, SEXP validate_jsonSEXP, SEXP datetime_digitsSEXP, SEXP datetime_offsetSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -164,10 +236,38 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< bool >::type numeric_dates(numeric_datesSEXP);
     Rcpp::traits::input_parameter< bool >::type factors_as_string(factors_as_stringSEXP);
     Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
-    rcpp_result_gen = Rcpp::wrap(rcpp_to_ndjson(lst, unbox, digits, numeric_dates, factors_as_string, by));
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type output(outputSEXP);
+    Rcpp::traits::input_parameter< int >::type chunk_size(chunk_sizeSEXP);
+    Rcpp::traits::input_parameter< bool >::type validate_json(validate_jsonSEXP);
+    Rcpp::traits::input_parameter< int >::type datetime_digits(datetime_digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type datetime_offset(datetime_offsetSEXP);
+    rcpp_result_gen = Rcpp::wrap(rcpp_to_ndjson(lst, unbox, digits, numeric_dates, factors_as_string, by, threads, output, chunk_size, validate_json, datetime_digits, datetime_offset));
     return rcpp_result_gen;
 END_RCPP
 }
+// rcpp_to_ndjson_file
+void rcpp_to_ndjson_file(SEXP lst, const char* file, bool unbox, int digits, bool numeric_dates, bool factors_as_string, std::string by, int buffer_size, std::string compress, int compression_level, bool validate_json, int datetime_digits, bool datetime_offset);
+RcppExport SEXP _jsonify_rcpp_to_ndjson_file(SEXP lstSEXP, SEXP fileSEXP, SEXP unboxSEXP, SEXP digitsSEXP, SEXP numeric_datesSEXP, SEXP factors_as_stringSEXP, SEXP bySEXP, SEXP buffer_sizeSEXP, SEXP compressSEXP, SEXP compression_levelSEXP, SEXP validate_jsonSEXP, SEXP datetime_digitsSEXP, SEXP datetime_offsetSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type lst(lstSEXP);
+    Rcpp::traits::input_parameter< const char* >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< bool >::type unbox(unboxSEXP);
+    Rcpp::traits::input_parameter< int >::type digits(digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type numeric_dates(numeric_datesSEXP);
+    Rcpp::traits::input_parameter< bool >::type factors_as_string(factors_as_stringSEXP);
+    Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
+    Rcpp::traits::input_parameter< int >::type buffer_size(buffer_sizeSEXP);
+    Rcpp::traits::input_parameter< std::string >::type compress(compressSEXP);
+    Rcpp::traits::input_parameter< int >::type compression_level(compression_levelSEXP);
+    Rcpp::traits::input_parameter< bool >::type validate_json(validate_jsonSEXP);
+    Rcpp::traits::input_parameter< int >::type datetime_digits(datetime_digitsSEXP);
+    Rcpp::traits::input_parameter< bool >::type datetime_offset(datetime_offsetSEXP);
+    rcpp_to_ndjson_file(lst, file, unbox, digits, numeric_dates, factors_as_string, by, buffer_size, compress, compression_level, validate_json, datetime_digits, datetime_offset);
+    return R_NilValue;
+END_RCPP
+}
 // rcpp_validate_json
 Rcpp::LogicalVector rcpp_validate_json(Rcpp::StringVector json);
 RcppExport SEXP _jsonify_rcpp_validate_json(SEXP jsonSEXP) {
@@ -181,7 +281,8 @@ END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_jsonify_rcpp_from_json", (DL_FUNC) &_jsonify_rcpp_from_json, 3},
+    {"_jsonify_rcpp_from_json", (DL_FUNC) &_jsonify_rcpp_from_json, 6},
+    {"_jsonify_rcpp_from_json_raw", (DL_FUNC) &_jsonify_rcpp_from_json_raw, 6},
     {"_jsonify_rcpp_parse_json", (DL_FUNC) &_jsonify_rcpp_parse_json, 1},
     {"_jsonify_rcpp_from_ndjson", (DL_FUNC) &_jsonify_rcpp_from_ndjson, 3},
     {"_jsonify_rcpp_get_dtypes", (DL_FUNC) &_jsonify_rcpp_get_dtypes, 1},
@@ -189,11 +290,15 @@ static const R_CallMethodDef CallEntries[] = {
     {"_jsonify_rcpp_pretty_json", (DL_FUNC) &_jsonify_rcpp_pretty_json, 1},
     {"_jsonify_rcpp_minify_json", (DL_FUNC) &_jsonify_rcpp_minify_json, 1},
     {"_jsonify_rcpp_pretty_print", (DL_FUNC) &_jsonify_rcpp_pretty_print, 1},
-    {"_jsonify_rcpp_read_json_file", (DL_FUNC) &_jsonify_rcpp_read_json_file, 5},
+    {"_jsonify_rcpp_read_json_file", (DL_FUNC) &_jsonify_rcpp_read_json_file, 7},
     {"_jsonify_rcpp_read_ndjson_file", (DL_FUNC) &_jsonify_rcpp_read_ndjson_file, 4},
+    {"_jsonify_rcpp_stats_enable", (DL_FUNC) &_jsonify_rcpp_stats_enable, 1},
+    {"_jsonify_rcpp_stats", (DL_FUNC) &_jsonify_rcpp_stats, 1},
     {"_jsonify_source_tests", (DL_FUNC) &_jsonify_source_tests, 0},
-    {"_jsonify_rcpp_to_json", (DL_FUNC) &_jsonify_rcpp_to_json, 6},
-    {"_jsonify_rcpp_to_ndjson", (DL_FUNC) &_jsonify_rcpp_to_ndjson, 6},
+    {"_jsonify_rcpp_to_json", (DL_FUNC) &_jsonify_rcpp_to_json, 12},
+    {"_jsonify_rcpp_to_json_file", (DL_FUNC) &_jsonify_rcpp_to_json_file, 14},
+    {"_jsonify_rcpp_to_ndjson", (DL_FUNC) &_jsonify_rcpp_to_ndjson, 12},
+    {"_jsonify_rcpp_to_ndjson_file", (DL_FUNC) &_jsonify_rcpp_to_ndjson_file, 13},
     {"_jsonify_rcpp_validate_json", (DL_FUNC) &_jsonify_rcpp_validate_json, 1},
     {NULL, NULL, 0}
 };
@@ -3,8 +3,21 @@
 #include <Rcpp.h>
 
 // [[Rcpp::export]]
-SEXP rcpp_from_json(const char * json, bool& simplify, bool& fill_na ) {
-  return jsonify::api::from_json( json, simplify, fill_na );
+SEXP rcpp_from_json(const char * json, bool& simplify, bool& fill_na, bool sax, SEXP schema, SEXP select ) {
+  if( sax ) {
+    return jsonify::api::from_json_sax( json, simplify, fill_na, select );
+  }
+  return jsonify::api::from_json( json, simplify, fill_na, schema, select );
+}
+
+// [[Rcpp::export]]
+SEXP rcpp_from_json_raw( Rcpp::RawVector json, bool& simplify, bool& fill_na, bool sax, SEXP schema, SEXP select ) {
+  const char* bytes = reinterpret_cast< const char* >( RAW( json ) );
+  size_t length = static_cast< size_t >( json.size() );
+  if( sax ) {
+    return jsonify::api::from_json_sax( bytes, length, simplify, fill_na, select );
+  }
+  return jsonify::api::from_json( bytes, length, simplify, fill_na, schema, select );
 }
 
 
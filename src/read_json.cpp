@@ -1,43 +1,33 @@
 #include <rapidjson/document.h>
-#include <rapidjson/filereadstream.h>
 
 #include <fstream>
 
 #include "jsonify/from_json/api.hpp"
+#include "jsonify/from_json/sources.hpp"
 
 #include <Rcpp.h>
 
 
-rapidjson::Document buffer_string( const char* file, const char* mode, int buffer_size = 1024 ) {
-  
-  FILE* fp = fopen(file, mode );
-  
-  // this crashes for large files...
-  //char readBuffer[ buffer_size ];
-  // ISO C++ forbids variable length array ‘readBuffer’ [-Wvla]
-  // https://stackoverflow.com/a/11379442/5977215
-  char *readBuffer = new char[ buffer_size ];
-
-  rapidjson::FileReadStream is(fp, readBuffer, sizeof( readBuffer ) );
-  
-  rapidjson::Document d;
-  d.ParseStream( is );
-  fclose(fp);
-  
-  delete[] readBuffer;
-  return d;
-}
-
+// the file is memory-mapped and parsed in place, so its strings are only copied
+// when they become R strings
 // [[Rcpp::export]]
 SEXP rcpp_read_json_file(
   const char* file,
   const char* mode,
   bool& simplify,
   bool& fill_na,
-  int buffer_size = 1024
+  bool sax,
+  SEXP schema,
+  SEXP select
 ) {
-  rapidjson::Document d = buffer_string( file, mode, buffer_size );
-  return jsonify::api::from_json( d, simplify, fill_na );
+  jsonify::sources::mapped_file mf( file, mode );
+  if( !mf.is_open() ) {
+    Rcpp::stop("jsonify - could not read file %s", file );
+  }
+  if( sax ) {
+    return jsonify::api::from_json_sax_insitu( mf.data(), mf.size(), simplify, fill_na, select );
+  }
+  return jsonify::api::from_json_insitu( mf.data(), mf.size(), simplify, fill_na, schema, select );
 }
 
 // [[Rcpp::export]]
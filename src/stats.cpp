@@ -0,0 +1,49 @@
+#include "jsonify/stats.hpp"
+#include <Rcpp.h>
+
+// [[Rcpp::export]]
+bool rcpp_stats_enable( bool enable ) {
+  return jsonify::stats::set_enabled( enable );
+}
+
+// [[Rcpp::export]]
+Rcpp::List rcpp_stats( bool reset ) {
+
+  int i;
+  jsonify::stats::state& s = jsonify::stats::get_state();
+
+  // doubles, because the counts can be larger than an R integer
+  Rcpp::StringVector stages( jsonify::stats::N_STAGES );
+  Rcpp::NumericVector calls( jsonify::stats::N_STAGES );
+  Rcpp::NumericVector ns( jsonify::stats::N_STAGES );
+  for( i = 0; i < jsonify::stats::N_STAGES; ++i ) {
+    stages[i] = jsonify::stats::stage_name( i );
+    calls[i] = static_cast< double >( s.calls[i].load() );
+    ns[i] = static_cast< double >( s.ns[i].load() );
+  }
+
+  Rcpp::NumericVector counters( jsonify::stats::N_COUNTERS );
+  Rcpp::StringVector counter_names( jsonify::stats::N_COUNTERS );
+  for( i = 0; i < jsonify::stats::N_COUNTERS; ++i ) {
+    counter_names[i] = jsonify::stats::counter_name( i );
+    counters[i] = static_cast< double >( s.counts[i].load() );
+  }
+  counters.attr("names") = counter_names;
+
+  Rcpp::DataFrame timers = Rcpp::DataFrame::create(
+    Rcpp::_["stage"] = stages,
+    Rcpp::_["calls"] = calls,
+    Rcpp::_["ns"] = ns,
+    Rcpp::_["stringsAsFactors"] = false
+  );
+
+  if( reset ) {
+    jsonify::stats::reset();
+  }
+
+  return Rcpp::List::create(
+    Rcpp::_["enabled"] = jsonify::stats::enabled(),
+    Rcpp::_["timers"] = timers,
+    Rcpp::_["counters"] = counters
+  );
+}
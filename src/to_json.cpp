@@ -2,23 +2,84 @@
 #include "jsonify/to_json/api.hpp"
 
 // [[Rcpp::export]]
-Rcpp::StringVector rcpp_to_json(
+SEXP rcpp_to_json(
     SEXP lst, 
     bool unbox = false, 
     int digits = -1, 
     bool numeric_dates = true, 
     bool factors_as_string = true,
-    std::string by = "row"
+    std::string by = "row",
+    int threads = 1,
+    std::string output = "character",
+    int chunk_size = 1048576,
+    bool validate_json = false,
+    int datetime_digits = 0,
+    bool datetime_offset = false
 ) {
-  
-  SEXP lst2 = Rcpp::clone( lst );
-  return jsonify::api::to_json( lst2, unbox, digits, numeric_dates, factors_as_string, by );
+  jsonify::dates::datetime_format datetime = jsonify::dates::make_datetime_format( datetime_digits, datetime_offset );
+  if( output == "chunks" ) {
+    return jsonify::api::to_json_chunks( lst, unbox, digits, numeric_dates, factors_as_string, by, threads, chunk_size, validate_json, datetime );
+  }
+  if( output == "raw" ) {
+    return jsonify::api::to_json_raw( lst, unbox, digits, numeric_dates, factors_as_string, by, threads, validate_json, datetime );
+  }
+  return jsonify::api::to_json( lst, unbox, digits, numeric_dates, factors_as_string, by, threads, validate_json, datetime );
 }
 
 // [[Rcpp::export]]
-Rcpp::StringVector rcpp_to_ndjson(
+void rcpp_to_json_file(
+    SEXP lst,
+    const char* file,
+    bool unbox = false, 
+    int digits = -1, 
+    bool numeric_dates = true, 
+    bool factors_as_string = true,
+    std::string by = "row",
+    int threads = 1,
+    int buffer_size = 65536,
+    std::string compress = "none",
+    int compression_level = 6,
+    bool validate_json = false,
+    int datetime_digits = 0,
+    bool datetime_offset = false
+) {
+  jsonify::dates::datetime_format datetime = jsonify::dates::make_datetime_format( datetime_digits, datetime_offset );
+  jsonify::api::to_json_file( lst, file, unbox, digits, numeric_dates, factors_as_string, by, threads, buffer_size, compress, compression_level, validate_json, datetime );
+}
+
+// [[Rcpp::export]]
+SEXP rcpp_to_ndjson(
   SEXP lst, bool unbox = false, int digits = -1, bool numeric_dates = true,
-  bool factors_as_string = true, std::string by = "row"
+  bool factors_as_string = true, std::string by = "row", int threads = 1,
+  std::string output = "character", int chunk_size = 1048576, bool validate_json = false,
+  int datetime_digits = 0, bool datetime_offset = false
+) {
+  jsonify::dates::datetime_format datetime = jsonify::dates::make_datetime_format( datetime_digits, datetime_offset );
+  if( output == "chunks" ) {
+    return jsonify::api::to_ndjson_chunks( lst, unbox, digits, numeric_dates, factors_as_string, by, chunk_size, validate_json, datetime );
+  }
+  if( output == "vector" ) {
+    return jsonify::api::to_ndjson_vector( lst, unbox, digits, numeric_dates, factors_as_string, by, threads, validate_json, datetime );
+  }
+  return jsonify::api::to_ndjson(lst, unbox, digits, numeric_dates, factors_as_string, by, validate_json, datetime );
+}
+
+// [[Rcpp::export]]
+void rcpp_to_ndjson_file(
+    SEXP lst,
+    const char* file,
+    bool unbox = false,
+    int digits = -1,
+    bool numeric_dates = true,
+    bool factors_as_string = true,
+    std::string by = "row",
+    int buffer_size = 65536,
+    std::string compress = "none",
+    int compression_level = 6,
+    bool validate_json = false,
+    int datetime_digits = 0,
+    bool datetime_offset = false
 ) {
-  return jsonify::api::to_ndjson(lst, unbox, digits, numeric_dates, factors_as_string, by );
+  jsonify::dates::datetime_format datetime = jsonify::dates::make_datetime_format( datetime_digits, datetime_offset );
+  jsonify::api::to_ndjson_file( lst, file, unbox, digits, numeric_dates, factors_as_string, by, buffer_size, compress, compression_level, validate_json, datetime );
 }